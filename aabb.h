@@ -0,0 +1,32 @@
+#pragma once
+
+#include <limits>
+#include "glm/glm.hpp"
+
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    float surfaceArea() const {
+        glm::vec3 extent = max - min;
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    bool isEmpty() const {
+        return min.x > max.x;
+    }
+};
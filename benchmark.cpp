@@ -0,0 +1,191 @@
+#include <SDL.h>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "benchmarks.h"
+#include "options.h"
+#include "renderer.h"
+#include "scenes.h"
+
+// Reproducible performance suite: renders the canonical scenes at their fixed camera
+// poses and prints one JSON document with rays/sec, per-phase times and memory. The
+// process's peak memory covers every scene run; --scene gives one scene's alone.
+//
+//   RaytracingBenchmark [--frames N] [--threads N] [--scene NAME] [--assets DIR] [--json FILE]
+//
+// Given a --bench-* mode, runs that benchmark instead (see benchmarks.h), taking the
+// same render options as Raytracing:
+//
+//   RaytracingBenchmark --bench-voxel 512 --resolution 1280x720
+
+namespace {
+    struct BenchmarkScene {
+        const char* name;
+        std::function<void()> setUp;
+    };
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    std::string runScene(const BenchmarkScene& benchmarkScene, ThreadPool& pool, int frames) {
+        auto start = std::chrono::steady_clock::now();
+        benchmarkScene.setUp();
+        double setupMs = millisecondsSince(start);
+
+        // Rebuild once more on its own to separate the BVH from texture loading and generation
+        start = std::chrono::steady_clock::now();
+        scene.build(objects);
+        double bvhMs = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        render(pool);
+        double firstFrameMs = millisecondsSince(start);
+
+        resetRayStats();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            render(pool);
+        }
+        double renderMs = millisecondsSince(start);
+        RayStats rays = rayStats();
+        double seconds = renderMs / 1000.0;
+
+        size_t sceneBytes = scene.memoryFootprint() + (world != nullptr ? world->memoryFootprint() : 0);
+
+        std::ostringstream json;
+        json << "    {\n"
+             << "      \"name\": \"" << benchmarkScene.name << "\",\n"
+             << "      \"boxes\": " << scene.boxCount() << ",\n"
+             << "      \"spheres\": " << scene.sphereCount() << ",\n"
+             << "      \"voxel_blocks\": " << (world != nullptr ? world->blockCount() : 0) << ",\n"
+             << "      \"phases_ms\": {\"setup\": " << setupMs << ", \"bvh_build\": " << bvhMs
+             << ", \"first_frame\": " << firstFrameMs << ", \"frame\": " << renderMs / frames << "},\n"
+             << "      \"rays_per_frame\": {\"primary\": " << rays.primary / frames << ", \"secondary\": " << rays.secondary / frames
+             << ", \"shadow\": " << rays.shadow / frames << "},\n"
+             << "      \"primary_rays_per_s\": " << rays.primary / seconds << ",\n"
+             << "      \"total_rays_per_s\": " << rays.total() / seconds << ",\n"
+             << "      \"scene_bytes\": " << sceneBytes << "\n"
+             << "    }";
+
+        clearScene();
+        return json.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]).rfind("--bench-", 0) == 0) {
+            RenderOptions options;
+            try {
+                options = parseOptions(argc, argv);
+            } catch (const std::invalid_argument& error) {
+                std::cerr << error.what() << std::endl;
+                printUsage(std::cerr);
+                return 2;
+            }
+            applyRenderOptions(options);
+            try {
+                skybox = new Skybox(assetPath("sky.png"));
+            } catch (const std::runtime_error& error) {
+                std::cerr << error.what() << std::endl;
+                return 1;
+            }
+            skybox->setBilinear(bilinearTextures);
+            return runBenchmark(options);
+        }
+    }
+
+    int frames = 5;
+    std::string only;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Unknown option or missing value: " << flag << std::endl;
+            return 2;
+        }
+        std::string value = argv[++i];
+        try {
+            if (flag == "--frames") {
+                frames = parseInt(flag, value, 1);
+            } else if (flag == "--threads") {
+                threadCount = parseInt(flag, value, 1);
+            } else if (flag == "--scene") {
+                only = value;
+            } else if (flag == "--assets") {
+                assetDirectory = value;
+            } else if (flag == "--json") {
+                jsonPath = value;
+            } else {
+                std::cerr << "Unknown option: " << flag << std::endl;
+                return 2;
+            }
+        } catch (const std::invalid_argument& error) {
+            std::cerr << error.what() << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        skybox = new Skybox(assetPath("sky.png"));
+    } catch (const std::runtime_error& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    const std::vector<BenchmarkScene> scenes = {
+            {"diorama", [] { setUp(); }},
+            {"diorama-voxel", [] { setUp(); buildVoxelWorld(); }},
+            {"glass", [] { setUpGlassScene(); }},
+            {"blocks-100k", [] { setUpRandomBlocks(90000, 10000); }},
+            {"terrain-128", [] { setUpTerrain(128); }},
+            {"terrain-512", [] { setUpTerrain(512); }},
+            {"lava-1000", [] { setUpLavaField(1000); }},
+    };
+
+    ThreadPool pool(threadCount);
+    std::vector<std::string> results;
+    for (const auto& benchmarkScene : scenes) {
+        if (!only.empty() && only != benchmarkScene.name) {
+            continue;
+        }
+        std::cerr << "running " << benchmarkScene.name << "..." << std::endl;
+        results.push_back(runScene(benchmarkScene, pool, frames));
+    }
+    if (results.empty()) {
+        std::cerr << "No scene named " << only << std::endl;
+        return 2;
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"resolution\": [" << screenWidth << ", " << screenHeight << "],\n"
+         << "  \"samples_per_pixel\": " << samplesPerPixel << ",\n"
+         << "  \"threads\": " << pool.size() << ",\n"
+         << "  \"packet_kernels\": \"" << (packetKernels != nullptr ? packetKernels->name : "off") << "\",\n"
+         << "  \"frames\": " << frames << ",\n"
+         << "  \"process_peak_memory_bytes\": " << peakMemoryBytes() << ",\n"
+         << "  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        json << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+
+    if (jsonPath.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream file(jsonPath);
+        file << json.str();
+        if (!file) {
+            std::cerr << "Unable to write " << jsonPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1105 @@
+#include "benchmarks.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "renderer.h"
+#include "scenes.h"
+#include "cube.h"
+#include "sphere.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+#endif
+
+size_t peakMemoryBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+size_t residentMemoryBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return static_cast<size_t>(info.resident_size);
+    }
+    return 0;
+#else
+    // Total program size, then resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t residentPages = 0;
+    statm >> pages >> residentPages;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+
+namespace {
+    // Per-channel (0-255) difference of a frame from a reference of the same size
+    struct ImageDifference {
+        double mean = 0.0;
+        int max = 0;
+        // Pixels off by more than the limit in some channel
+        size_t pixelsOff = 0;
+    };
+
+    ImageDifference compareFrames(const std::vector<Uint32>& reference, const Uint32* frame, int limit = 0) {
+        ImageDifference result;
+        unsigned long long total = 0;
+        for (size_t p = 0; p < reference.size(); p++) {
+            int pixelMax = 0;
+            for (int shift = 0; shift < 24; shift += 8) {
+                int channel = std::abs(static_cast<int>((reference[p] >> shift) & 0xFF) - static_cast<int>((frame[p] >> shift) & 0xFF));
+                total += channel;
+                pixelMax = std::max(pixelMax, channel);
+            }
+            result.max = std::max(result.max, pixelMax);
+            result.pixelsOff += pixelMax > limit;
+        }
+        result.mean = static_cast<double>(total) / (reference.size() * 3);
+        return result;
+    }
+}
+
+// Renders the setUp() scene with 1..N threads and reports frame time scaling
+int benchmarkThreads(int frames) {
+    loadScene();
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0.0;
+    std::cout << "threads  frame_ms  speedup" << std::endl;
+    for (unsigned int threads : threadCounts) {
+        ThreadPool pool(threads);
+        render(pool); // warm-up
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            render(pool);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        double frameMs = elapsed.count() / frames;
+
+        if (baseline == 0.0) {
+            baseline = frameMs;
+        }
+        std::cout << threads << "  " << frameMs << "  " << baseline / frameMs << std::endl;
+    }
+    return 0;
+}
+
+
+// Renders a procedural block terrain of worldSize^3 cells through the voxel DDA
+int benchmarkVoxelWorld(int worldSize) {
+    auto start = std::chrono::steady_clock::now();
+    setUpTerrain(worldSize);
+    std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+    ThreadPool pool(threadCount);
+    render(pool); // warm-up
+
+    const int frames = 3;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        render(pool);
+    }
+    std::chrono::duration<double, std::milli> renderTime = std::chrono::steady_clock::now() - start;
+    double frameMs = renderTime.count() / frames;
+
+    std::cout << "world: " << worldSize << "^3, " << world->blockCount() << " blocks, built in " << buildTime.count() << " ms, "
+              << world->memoryFootprint() / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << "frame: " << frameMs << " ms, " << screenWidth * screenHeight / (frameMs / 1000.0) << " primary rays/s" << std::endl;
+    return 0;
+}
+
+// Rays from a sphere around the region towards random points inside it
+void makeBenchmarkRays(int side, int count, std::mt19937& rng, std::vector<glm::vec3>& origins, std::vector<glm::vec3>& directions) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 onSphere = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))) * (float)side * 1.5f;
+        glm::vec3 target = glm::vec3(unit(rng), unit(rng), unit(rng)) * (float)side * 0.5f;
+        origins.push_back(onSphere);
+        directions.push_back(glm::normalize(target - onSphere));
+    }
+}
+
+// Brickmap storage of terrains from 128^3 up to maxSize^3: build time, memory and bytes
+// per block against one byte per cell, and closest-hit rays/s of the voxel walk alone
+// for rays from around the world towards random points inside it (one thread).
+int benchmarkBricks(int maxSize) {
+    std::mt19937 rng(1234);
+    std::cout << "size  blocks  dense_bricks  build_ms  mb  bytes_per_block  dense_grid_mb  rays_per_s  hit_fraction" << std::endl;
+    for (int worldSize = 128; worldSize <= maxSize; worldSize *= 2) {
+        auto start = std::chrono::steady_clock::now();
+        setUpTerrain(worldSize);
+        std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+        std::vector<glm::vec3> origins;
+        std::vector<glm::vec3> directions;
+        makeBenchmarkRays(worldSize, 200000, rng, origins, directions);
+        int hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < origins.size(); r++) {
+            Intersect intersect;
+            Uint8 materialId;
+            hits += world->rayIntersect(origins[r] + glm::vec3(0.5f * worldSize), directions[r], intersect, materialId);
+        }
+        std::chrono::duration<double> traceTime = std::chrono::steady_clock::now() - start;
+
+        size_t blocks = world->blockCount();
+        double denseGridBytes = static_cast<double>(worldSize) * worldSize * worldSize;
+        std::cout << worldSize << "  " << blocks << "  " << world->denseBrickCount() << "  " << buildTime.count() << "  "
+                  << world->memoryFootprint() / (1024.0 * 1024.0) << "  " << static_cast<double>(world->memoryFootprint()) / blocks << "  "
+                  << denseGridBytes / (1024.0 * 1024.0) << "  " << origins.size() / traceTime.count() << "  "
+                  << static_cast<double>(hits) / origins.size() << std::endl;
+        clearScene();
+    }
+    return 0;
+}
+
+// Out-of-core terrain: writes a worldSize^3 terrain to terrain-<size>.vxc one slab at a
+// time, then flies the camera across it streamed with worldBudget bytes resident, without
+// and with the prefetcher: frame times, peak resident memory, page-ins and evictions. Up
+// to 1024 the same flight runs on the terrain held in memory (open_ms is its build time).
+// The memory is the process's peak RSS above what it held before opening the world, as
+// the OS counts it rather than as the stream does.
+// The file is still in the OS page cache after being written, so a page-in here costs a
+// minor fault, not a disk read.
+int benchmarkStreaming(int worldSize) {
+    std::string path = "terrain-" + std::to_string(worldSize) + ".vxc";
+    auto start = std::chrono::steady_clock::now();
+    writeTerrain(path, worldSize);
+    std::chrono::duration<double, std::milli> writeTime = std::chrono::steady_clock::now() - start;
+    std::cout << "wrote " << path << ": " << std::filesystem::file_size(path) / (1024.0 * 1024.0) << " MB in " << writeTime.count()
+              << " ms, budget " << worldBudget / (1024.0 * 1024.0) << " MB" << std::endl;
+
+    ThreadPool pool(threadCount);
+    const int frames = 120;
+    float size = static_cast<float>(worldSize);
+    auto fly = [&](const char* label, bool prefetch, double openMs, size_t baseResident) {
+        std::vector<double> frameTimes;
+        size_t peakResident = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            // Diagonally across the world, above the highest hills, looking ahead and down
+            float t = static_cast<float>(frame) / (frames - 1);
+            camera.position = glm::mix(glm::vec3(0.1f * size, 0.55f * size, 0.1f * size), glm::vec3(0.9f * size, 0.55f * size, 0.9f * size), t);
+            camera.target = camera.position + glm::vec3(1.0f, -0.5f, 1.0f);
+            auto frameStart = std::chrono::steady_clock::now();
+            if (prefetch) {
+                prefetchWorld();
+            }
+            render(pool);
+            std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+            frameTimes.push_back(frameTime.count());
+            peakResident = std::max(peakResident, residentMemoryBytes());
+        }
+        const ChunkStream* stream = world->getStream();
+        double meanMs = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / frames;
+        std::sort(frameTimes.begin(), frameTimes.end());
+        std::cout << label << "  " << openMs << "  " << meanMs << "  " << frameTimes[frames * 95 / 100] << "  " << frameTimes.back() << "  "
+                  << (peakResident - std::min(peakResident, baseResident)) / (1024.0 * 1024.0) << "  " << (stream != nullptr ? stream->pageIns() : 0) << "  "
+                  << (stream != nullptr ? stream->evictions() : 0) << std::endl;
+    };
+
+    std::cout << "world  open_ms  mean_ms  p95_ms  max_ms  peak_rss_mb  page_ins  evictions" << std::endl;
+    for (bool prefetch : {false, true}) {
+        size_t baseResident = residentMemoryBytes();
+        start = std::chrono::steady_clock::now();
+        setUpStreamedTerrain(path, worldBudget);
+        std::chrono::duration<double, std::milli> openTime = std::chrono::steady_clock::now() - start;
+        fly(prefetch ? "streamed+prefetch" : "streamed", prefetch, openTime.count(), baseResident);
+        clearScene();
+    }
+    if (worldSize <= 1024) {
+        size_t baseResident = residentMemoryBytes();
+        start = std::chrono::steady_clock::now();
+        setUpTerrain(worldSize);
+        std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+        fly("memory", false, buildTime.count(), baseResident);
+        clearScene();
+    }
+    return 0;
+}
+
+// Compares closest-hit rays/sec of the BVH against a linear scan over growing random block scenes
+int benchmarkBVH() {
+    std::mt19937 rng(1234);
+
+    std::cout << "cubes  build_ms  linear_rays_per_s  bvh_rays_per_s  speedup  hit_fraction" << std::endl;
+    for (int cubeCount : {100, 1000, 10000, 100000}) {
+        int side = blockRegionSide(cubeCount);
+        std::vector<Object*> cubes = makeRandomBlocks(cubeCount, 0, rng);
+
+        std::vector<glm::vec3> origins;
+        std::vector<glm::vec3> directions;
+        makeBenchmarkRays(side, 20000, rng, origins, directions);
+
+        auto start = std::chrono::steady_clock::now();
+        Scene blockScene;
+        blockScene.build(cubes);
+        std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+        // Keep the linear scan to about 10^8 box tests
+        int linearRays = std::clamp(100000000 / cubeCount, 100, static_cast<int>(origins.size()));
+        int linearHits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < linearRays; r++) {
+            float zBuffer = 99999;
+            bool hit = false;
+            for (const auto& cube : cubes) {
+                Intersect i = cube->rayIntersect(origins[r], directions[r]);
+                if (i.isIntersecting && i.dist < zBuffer) {
+                    zBuffer = i.dist;
+                    hit = true;
+                }
+            }
+            linearHits += hit;
+        }
+        std::chrono::duration<double> linearTime = std::chrono::steady_clock::now() - start;
+
+        int bvhHits = 0;
+        std::vector<bool> bvhHitFlags(origins.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < origins.size(); r++) {
+            SceneHit hit;
+            bvhHitFlags[r] = blockScene.closestHit(origins[r], directions[r], hit);
+            bvhHits += bvhHitFlags[r];
+        }
+        std::chrono::duration<double> bvhTime = std::chrono::steady_clock::now() - start;
+
+        double linearRate = linearRays / linearTime.count();
+        double bvhRate = origins.size() / bvhTime.count();
+        std::cout << cubeCount << "  " << buildTime.count() << "  " << linearRate << "  " << bvhRate
+                  << "  " << bvhRate / linearRate << "  " << static_cast<double>(bvhHits) / origins.size() << std::endl;
+
+        if (linearHits != std::count_if(bvhHitFlags.begin(), bvhHitFlags.begin() + linearRays, [](bool hit) { return hit; })) {
+            std::cerr << "BVH and linear scan disagree on hit count" << std::endl;
+        }
+
+        for (auto& cube : cubes) {
+            delete cube;
+        }
+    }
+    return 0;
+}
+
+// Compares the Object* layout (heap objects, virtual rayIntersect, BVH over their
+// bounds) with the flattened structure-of-arrays Scene: memory and rays/sec
+int benchmarkSceneLayout() {
+    std::mt19937 rng(1234);
+
+    std::cout << "primitives  object_bytes  scene_bytes  object_rays_per_s  scene_rays_per_s  speedup" << std::endl;
+    for (int count : {1000, 10000, 100000}) {
+        int sphereCount = count / 10;
+        std::vector<Object*> blocks = makeRandomBlocks(count - sphereCount, sphereCount, rng);
+
+        std::vector<glm::vec3> origins;
+        std::vector<glm::vec3> directions;
+        makeBenchmarkRays(blockRegionSide(count), 50000, rng, origins, directions);
+
+        std::vector<AABB> bounds;
+        for (const auto& block : blocks) {
+            bounds.push_back(block->getBounds());
+        }
+        BVH objectBVH;
+        objectBVH.build(bounds);
+        const std::vector<int>& order = objectBVH.getPrimitiveOrder();
+
+        // Object size plus the pointer to it and a typical 16-byte allocator header
+        size_t objectBytes = blocks.capacity() * sizeof(Object*) + objectBVH.memoryFootprint();
+        for (const auto& block : blocks) {
+            objectBytes += (dynamic_cast<Cube*>(block) != nullptr ? sizeof(Cube) : sizeof(Sphere)) + 16;
+        }
+
+        Scene blockScene;
+        blockScene.build(blocks);
+
+        int objectHits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < origins.size(); r++) {
+            float zBuffer = 99999;
+            bool hit = false;
+            objectBVH.closestHit(Ray(origins[r], directions[r]), zBuffer, [&](int first, int primitiveCount, float& tMax) {
+                for (int i = first; i < first + primitiveCount; i++) {
+                    Intersect candidate = blocks[order[i]]->rayIntersect(origins[r], directions[r]);
+                    if (candidate.isIntersecting && candidate.dist < tMax) {
+                        tMax = candidate.dist;
+                        hit = true;
+                    }
+                }
+            });
+            objectHits += hit;
+        }
+        std::chrono::duration<double> objectTime = std::chrono::steady_clock::now() - start;
+
+        int sceneHits = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < origins.size(); r++) {
+            SceneHit hit;
+            sceneHits += blockScene.closestHit(origins[r], directions[r], hit);
+        }
+        std::chrono::duration<double> sceneTime = std::chrono::steady_clock::now() - start;
+
+        double objectRate = origins.size() / objectTime.count();
+        double sceneRate = origins.size() / sceneTime.count();
+        std::cout << count << "  " << objectBytes << "  " << blockScene.memoryFootprint() << "  " << objectRate
+                  << "  " << sceneRate << "  " << sceneRate / objectRate << std::endl;
+
+        if (objectHits != sceneHits) {
+            std::cerr << "Object and Scene layouts disagree on hit count" << std::endl;
+        }
+
+        for (auto& block : blocks) {
+            delete block;
+        }
+    }
+    return 0;
+}
+
+
+// Hit and miss throughput of a single box test: the full Cube::rayIntersect (slab plus
+// normal and UV, what every candidate closer than zBuffer used to pay) against the
+// distance-only slab test on a Ray with precomputed inverse direction
+int benchmarkSlab() {
+    const int rayCount = 1000000;
+    const int repeats = 20;
+    Material white = {Color(255, 255, 255), 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, nullptr};
+    Cube cube(glm::vec3(-0.5f), glm::vec3(0.5f), white);
+    AABB bounds = cube.getBounds();
+
+    // Rays from a sphere of radius 3 towards the box; misses pass at least 1.3 from its center
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> origins, hitDirections, missDirections;
+    for (int i = 0; i < rayCount; i++) {
+        glm::vec3 origin = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))) * 3.0f;
+        glm::vec3 target = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.4f;
+        glm::vec3 side = glm::normalize(glm::cross(target - origin, glm::vec3(unit(rng), unit(rng), unit(rng))));
+        origins.push_back(origin);
+        hitDirections.push_back(glm::normalize(target - origin));
+        missDirections.push_back(glm::normalize(target + side * 2.0f - origin));
+    }
+
+    std::cout << "rays  test  rays_per_s  hit_fraction" << std::endl;
+    for (const auto& [setName, directions] : {std::make_pair("hit", &hitDirections), std::make_pair("miss", &missDirections)}) {
+        auto measure = [&](const char* testName, auto&& test) {
+            int hits = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; r++) {
+                for (int i = 0; i < rayCount; i++) {
+                    hits += test(origins[i], (*directions)[i]);
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << setName << "  " << testName << "  " << static_cast<double>(rayCount) * repeats / elapsed.count()
+                      << "  " << static_cast<double>(hits) / (static_cast<double>(rayCount) * repeats) << std::endl;
+        };
+
+        measure("rayIntersect", [&](const glm::vec3& origin, const glm::vec3& direction) {
+            return cube.rayIntersect(origin, direction).isIntersecting;
+        });
+        measure("slabTest", [&](const glm::vec3& origin, const glm::vec3& direction) {
+            float tMin;
+            return Cube::slabTest(bounds.min, bounds.max, Ray(origin, direction), tMin);
+        });
+    }
+    return 0;
+}
+
+// Frame time of the per-ray path against every packet kernel set the CPU supports,
+// on the diorama and on 10k random cubes. Pixels that differ from the per-ray frame
+// are counted to catch divergent lanes.
+int benchmarkPackets(int frames) {
+    std::vector<const PacketKernels*> kernelSets = {nullptr, scalarPacketKernels()};
+    for (const PacketKernels* kernels : {ssePacketKernels(), avx2PacketKernels()}) {
+        if (kernels != nullptr) {
+            kernelSets.push_back(kernels);
+        }
+    }
+
+    ThreadPool pool(threadCount);
+    auto measure = [&](const char* sceneName) {
+        double baseline = 0.0;
+        std::vector<Uint32> reference;
+        for (const PacketKernels* kernels : kernelSets) {
+            packetKernels = kernels;
+            render(pool); // warm-up
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            double frameMs = elapsed.count() / frames;
+
+            const Uint32* pixels = framebuffer.data();
+            int mismatched = 0;
+            if (baseline == 0.0) {
+                baseline = frameMs;
+                reference.assign(pixels, pixels + screenWidth * screenHeight);
+            } else {
+                for (int i = 0; i < screenWidth * screenHeight; i++) {
+                    mismatched += pixels[i] != reference[i];
+                }
+            }
+            std::cout << sceneName << "  " << (kernels != nullptr ? kernels->name : "per-ray") << "  " << frameMs
+                      << "  " << baseline / frameMs << "  " << mismatched << std::endl;
+        }
+    };
+
+    std::cout << "scene  kernels  frame_ms  speedup  mismatched_pixels" << std::endl;
+    loadScene();
+    measure("diorama");
+
+    clearScene();
+    setUpRandomBlocks(10000, 0);
+    measure("cubes-10k");
+    return 0;
+}
+
+// Texture lookups per second through the old per-hit SDL_GetRGBA path and through the
+// pre-decoded tiled Texture, for a block texture and for the large sky image, with
+// random and with coherent (neighbouring pixels) UVs. Then frame times with and
+// without mipmaps, nearest and bilinear, on the diorama and on a terrain.
+int benchmarkTextures(int frames) {
+    const int lookupCount = 1 << 22;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec2> randomUVs, coherentUVs;
+    for (int i = 0; i < lookupCount; i++) {
+        randomUVs.emplace_back(unit(rng), unit(rng));
+        // Scanline order: small steps along u, then the next row
+        coherentUVs.emplace_back(static_cast<float>(i % 1024) / 2048.0f, static_cast<float>(i / 1024 % 1024) / 2048.0f);
+    }
+
+    std::cout << "texture  size  uvs  path  lookups_per_s" << std::endl;
+    for (const char* file : {"stone.png", "sky.png"}) {
+        SDL_Surface* surface = IMG_Load(assetPath(file).c_str());
+        if (surface == nullptr) {
+            std::cerr << "Unable to load image: " << IMG_GetError() << std::endl;
+            return 1;
+        }
+        Texture texture(surface);
+
+        for (const auto& [uvName, uvs] : {std::make_pair("random", &randomUVs), std::make_pair("coherent", &coherentUVs)}) {
+            auto measure = [&](const char* pathName, auto&& lookup) {
+                float checksum = 0.0f;
+                auto start = std::chrono::steady_clock::now();
+                for (const glm::vec2& uv : *uvs) {
+                    Radiance color = lookup(uv.x, uv.y);
+                    checksum += color.x + color.y + color.z;
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << file << "  " << surface->w << "x" << surface->h << "  " << uvName << "  " << pathName << "  "
+                          << lookupCount / elapsed.count() << (checksum == 0 ? "  (blank)" : "") << std::endl;
+            };
+
+            measure("SDL_GetRGBA", [&](float u, float v) {
+                Color color = {0, 0, 0, 0};
+                int x = static_cast<int>(u * surface->w);
+                int y = static_cast<int>(v * surface->h);
+                Uint32 pixel = 0;
+                Uint8* p = (Uint8*)surface->pixels + y * surface->pitch + x * surface->format->BytesPerPixel;
+                memcpy(&pixel, p, surface->format->BytesPerPixel);
+                SDL_GetRGBA(pixel, surface->format, &color.r, &color.g, &color.b, &color.a);
+                return toRadiance(color);
+            });
+            measure("nearest", [&](float u, float v) { return texture.sample(u, v); });
+            measure("bilinear", [&](float u, float v) { return texture.sampleBilinear(u, v); });
+        }
+        SDL_FreeSurface(surface);
+    }
+
+    ThreadPool pool(threadCount);
+    auto measureFrames = [&](const char* sceneName) {
+        for (bool mipmaps : {false, true}) {
+            for (bool bilinear : {false, true}) {
+                mipmapping = mipmaps;
+                bilinearTextures = bilinear;
+                skybox->setBilinear(bilinear);
+                render(pool); // warm-up
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < frames; i++) {
+                    render(pool);
+                }
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << sceneName << "  " << (mipmaps ? "on" : "off") << "  " << (bilinear ? "bilinear" : "nearest")
+                          << "  " << elapsed.count() / frames << std::endl;
+            }
+        }
+    };
+
+    // The terrain shows many distant block faces, where mip levels matter most
+    std::cout << "scene  mipmaps  filter  frame_ms" << std::endl;
+    loadScene();
+    measureFrames("diorama");
+    clearScene();
+    setUpTerrain(256);
+    measureFrames("terrain-256");
+    return 0;
+}
+
+// Sky lookups per second through the equirect atan2/acos mapping the skybox used
+// before and through the cubemap, then frame times for views that mostly miss the
+// scene: straight up, and towards the horizon past the diorama.
+int benchmarkSkybox(int frames) {
+    const int lookupCount = 1 << 22;
+
+    SDL_Surface* surface = IMG_Load(assetPath("sky.png").c_str());
+    if (surface == nullptr) {
+        std::cerr << "Unable to load image: " << IMG_GetError() << std::endl;
+        return 1;
+    }
+    Texture equirect(surface);
+    SDL_FreeSurface(surface);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> directions;
+    for (int i = 0; i < lookupCount; i++) {
+        directions.push_back(glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))));
+    }
+
+    std::cout << "lookup  lookups_per_s" << std::endl;
+    auto measure = [&](const char* name, auto&& lookup) {
+        float checksum = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (const glm::vec3& direction : directions) {
+            Radiance color = lookup(direction);
+            checksum += color.x + color.y + color.z;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << "  " << lookupCount / elapsed.count() << (checksum == 0 ? "  (blank)" : "") << std::endl;
+    };
+    measure("equirect", [&](const glm::vec3& direction) {
+        float phi = atan2(direction.z, direction.x);
+        float theta = acos(direction.y);
+        return equirect.sample(0.5f + phi / (2 * M_PI), theta / M_PI);
+    });
+    for (bool bilinear : {false, true}) {
+        skybox->setBilinear(bilinear);
+        measure(bilinear ? "cubemap-bilinear" : "cubemap-nearest", [&](const glm::vec3& direction) {
+            return skybox->getColor(direction);
+        });
+    }
+    skybox->setBilinear(bilinearTextures);
+
+    ThreadPool pool(threadCount);
+    loadScene();
+    glm::vec3 position = camera.position;
+    std::cout << "view  frame_ms  rays_per_s" << std::endl;
+    for (const auto& [viewName, target] : {std::make_pair("up", position + glm::vec3(0.01f, 1.0f, 0.0f)),
+                                           std::make_pair("horizon", position + glm::vec3(-1.0f, 0.1f, 0.0f))}) {
+        camera.target = target;
+        render(pool); // warm-up
+        resetRayStats();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            render(pool);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << viewName << "  " << elapsed.count() / frames << "  " << rayStats().total() / (elapsed.count() / 1000.0) << std::endl;
+    }
+    return 0;
+}
+
+// What a progressive window would see: time until each preview and the first full
+// sample are on screen, time to reach maxSamples, and how long a restart takes while
+// a full-resolution pass is running. Diorama, then 100k blocks and a 512 terrain.
+int benchmarkProgressive(int maxSamples) {
+    ThreadPool pool(threadCount);
+    auto measure = [&](const char* sceneName) {
+        ProgressiveRenderer progressive(maxSamples);
+        auto start = std::chrono::steady_clock::now();
+        auto elapsedMs = [&] {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        std::cout << sceneName;
+        for (int pass = 0; !progressive.converged(); pass++) {
+            progressive.startPass(pool);
+            while (!progressive.finishPass(pool)) {
+                std::this_thread::yield();
+            }
+            if (pass < 4) {
+                std::cout << "  " << elapsedMs();
+            }
+        }
+        std::cout << "  " << elapsedMs();
+
+        // Cancel a full-resolution pass right after it started
+        progressive.startPass(pool);
+        auto restartStart = std::chrono::steady_clock::now();
+        progressive.restart(pool);
+        std::chrono::duration<double, std::milli> restart = std::chrono::steady_clock::now() - restartStart;
+        std::cout << "  " << restart.count() << std::endl;
+    };
+
+    std::cout << "scene  1/8_ms  1/4_ms  1/2_ms  full_ms  converged_ms  restart_ms" << std::endl;
+    loadScene();
+    measure("diorama");
+    clearScene();
+    setUpRandomBlocks(90000, 10000);
+    measure("blocks-100k");
+    clearScene();
+    setUpTerrain(512);
+    measure("terrain-512");
+    return 0;
+}
+
+// Cost of re-rendering after the camera orbits by a small and by a full keypress step:
+// full render() against ReprojectionCache, the share of pixels reused and the mean
+// per-channel difference from the full render (0-255). Diorama, glass scene, 512 terrain.
+int benchmarkReprojection(int frames) {
+    ThreadPool pool(threadCount);
+    auto measure = [&](const char* sceneName) {
+        glm::vec3 position = camera.position;
+        for (float step : {0.1f, 1.0f}) {
+            camera.position = position;
+            ReprojectionCache reprojection;
+            reprojection.render(pool);
+            double fullMs = 0.0;
+            double reprojectedMs = 0.0;
+            double reused = 0.0;
+            double error = 0.0;
+            for (int i = 0; i < frames; i++) {
+                camera.rotate(step, 0.0f);
+                auto start = std::chrono::steady_clock::now();
+                render(pool);
+                fullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::vector<Uint32> full(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+
+                start = std::chrono::steady_clock::now();
+                reprojection.render(pool);
+                reprojectedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                reused += reprojection.reusedFraction();
+
+                error += compareFrames(full, framebuffer.data()).mean;
+            }
+            std::cout << sceneName << "  " << step * camera.rotationSpeed << "  " << fullMs / frames << "  " << reprojectedMs / frames
+                      << "  " << fullMs / reprojectedMs << "  " << 100.0 * reused / frames << "  " << error / frames << std::endl;
+        }
+        camera.position = position;
+    };
+
+    std::cout << "scene  degrees  full_ms  reprojected_ms  speedup  reused_%  mean_error" << std::endl;
+    loadScene();
+    measure("diorama");
+    clearScene();
+    setUpGlassScene();
+    measure("glass");
+    clearScene();
+    setUpTerrain(512);
+    measure("terrain-512");
+    return 0;
+}
+
+// Full render() against GBuffer::relight() after the light moves and after a material
+// changes, with the G-buffer pass itself and whether both give the same image.
+// Diorama, then 100k blocks and a 512 terrain.
+int benchmarkRelight(int frames) {
+    ThreadPool pool(threadCount);
+    auto measure = [&](const char* sceneName) {
+        GBuffer gbuffer;
+        auto start = std::chrono::steady_clock::now();
+        gbuffer.render(pool);
+        std::chrono::duration<double, std::milli> gbufferTime = std::chrono::steady_clock::now() - start;
+        render(pool); // warm-up
+
+        auto compare = [&](const char* change) {
+            double fullMs = 0.0;
+            double relightMs = 0.0;
+            size_t differing = 0;
+            for (int i = 0; i < frames; i++) {
+                if (std::strcmp(change, "light") == 0) {
+                    light.position += glm::vec3(0.5f, 0.0f, -0.25f);
+                } else if (world != nullptr) {
+                    Material material = world->getMaterial(1);
+                    material.albedo *= 0.9f;
+                    world->setMaterial(1, material);
+                } else {
+                    Material material = scene.getMaterial(i % scene.materialCount());
+                    material.albedo *= 0.9f;
+                    scene.setMaterial(i % scene.materialCount(), material);
+                }
+
+                start = std::chrono::steady_clock::now();
+                render(pool);
+                fullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::vector<Uint32> full(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+
+                start = std::chrono::steady_clock::now();
+                gbuffer.relight(pool);
+                relightMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                differing += compareFrames(full, framebuffer.data()).pixelsOff;
+            }
+            std::cout << sceneName << "  " << change << "  " << gbufferTime.count() << "  " << gbuffer.memoryFootprint() / (1024.0 * 1024.0)
+                      << "  " << fullMs / frames << "  " << relightMs / frames << "  " << fullMs / relightMs << "  " << differing << std::endl;
+        };
+        compare("light");
+        compare("material");
+    };
+
+    std::cout << "scene  change  gbuffer_ms  gbuffer_mb  full_ms  relight_ms  speedup  differing_pixels" << std::endl;
+    loadScene();
+    measure("diorama");
+    clearScene();
+    setUpRandomBlocks(90000, 10000);
+    measure("blocks-100k");
+    clearScene();
+    setUpTerrain(512);
+    measure("terrain-512");
+    return 0;
+}
+
+// Mirror and glass scene at growing --max-depth, with and without culling of weak
+// reflected and refracted rays: frame time, secondary rays per frame and the mean
+// per-channel difference culling makes (0-255). Without culling, paths through glass
+// double at every bounce, so that column stops at depth 8.
+int benchmarkDepth(int frames) {
+    ThreadPool pool(threadCount);
+    setUpGlassScene();
+    std::cout << "depth  culled_ms  culled_secondary  full_ms  full_secondary  mean_error" << std::endl;
+    for (int depth : {1, 2, 3, 4, 6, 8, 12, 16}) {
+        maxDepth = depth;
+        auto measure = [&](bool culling, double& ms, unsigned long long& secondary) {
+            rayCulling = culling;
+            render(pool); // warm-up
+            resetRayStats();
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+            secondary = rayStats().secondary / frames;
+        };
+
+        double culledMs;
+        unsigned long long culledSecondary;
+        measure(true, culledMs, culledSecondary);
+        std::cout << depth << "  " << culledMs << "  " << culledSecondary;
+        if (depth > 8) {
+            std::cout << "  -  -  -" << std::endl;
+            continue;
+        }
+        std::vector<Uint32> culled(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+
+        double fullMs;
+        unsigned long long fullSecondary;
+        measure(false, fullMs, fullSecondary);
+        std::cout << "  " << fullMs << "  " << fullSecondary << "  " << compareFrames(culled, framebuffer.data()).mean << std::endl;
+    }
+    return 0;
+}
+
+// Per-pixel render() against the wavefront path on the same scenes: frame time, rays per
+// second, where the wavefront's time goes and how much the images differ. At depth 1 the
+// images match without the occluder cache; with it, shadow rays are packed differently
+// and a shadowed point may report another occluder. Deeper, the wavefront intersects
+// secondary rays in packets, which can round a hit point's last bit differently from
+// closestHit(); roulette hashes the direction, so a few weak rays then survive in one
+// image and not in the other.
+int benchmarkWavefront(int frames) {
+    ThreadPool pool(threadCount);
+    auto measure = [&](const std::string& sceneName) {
+        auto time = [&](bool wavefrontPath, double& ms, double& raysPerSecond) {
+            wavefront = wavefrontPath;
+            render(pool); // warm-up
+            resetRayStats();
+            resetWavefrontStats();
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            RayStats stats = rayStats();
+            ms = seconds * 1000.0 / frames;
+            raysPerSecond = (stats.primary + stats.secondary + stats.shadow) / seconds;
+        };
+
+        double pixelMs, pixelRays;
+        time(false, pixelMs, pixelRays);
+        std::vector<Uint32> reference(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+        double waveMs, waveRays;
+        time(true, waveMs, waveRays);
+        WavefrontStats stages = wavefrontStats();
+        wavefront = false;
+
+        ImageDifference difference = compareFrames(reference, framebuffer.data());
+        std::cout << sceneName << "  " << maxDepth << "  " << pixelMs << "  " << pixelRays / 1e6 << "  " << waveMs << "  " << waveRays / 1e6
+                  << "  " << pixelMs / waveMs << "  " << stages.generateMs / frames << "/" << stages.intersectMs / frames << "/"
+                  << stages.shadowMs / frames << "/" << stages.sortMs / frames << "/" << stages.shadeMs / frames << "  " << difference.pixelsOff << "  "
+                  << difference.max << std::endl;
+    };
+
+    std::cout << "scene  depth  pixel_ms  pixel_mrays  wavefront_ms  wavefront_mrays  speedup  "
+                 "generate/intersect/shadow/sort/shade_ms  differing_pixels  max_difference" << std::endl;
+    loadScene();
+    measure("diorama");
+    clearScene();
+    setUpGlassScene();
+    int depth = maxDepth;
+    for (int glassDepth : {1, 4, 8}) {
+        maxDepth = glassDepth;
+        measure("glass");
+    }
+    maxDepth = depth;
+    clearScene();
+    setUpRandomBlocks(90000, 10000);
+    measure("blocks-100k");
+    clearScene();
+    setUpTerrain(512);
+    measure("terrain-512");
+    return 0;
+}
+
+// Shadow rays per second with and without the per-thread occluder cache. The rate is
+// the wavefront's shadow stage alone (shadow rays over the CPU time of that stage);
+// frame times are for the per-pixel render(), whose image the cache may change slightly.
+int benchmarkShadows(int frames) {
+    ThreadPool pool(threadCount);
+    auto measure = [&](const std::string& sceneName) {
+        double shadowRate[2];
+        double frameMs[2];
+        std::vector<Uint32> images[2];
+        for (int cached = 0; cached < 2; cached++) {
+            occluderCache = cached == 1;
+
+            wavefront = true;
+            render(pool); // warm-up
+            resetRayStats();
+            resetWavefrontStats();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            shadowRate[cached] = rayStats().shadow / (wavefrontStats().shadowMs / 1000.0);
+
+            wavefront = false;
+            render(pool);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            frameMs[cached] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+            images[cached].assign(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+        }
+        std::cout << sceneName << "  " << shadowRate[0] / 1e6 << "  " << shadowRate[1] / 1e6 << "  " << shadowRate[1] / shadowRate[0] << "  "
+                  << frameMs[0] << "  " << frameMs[1] << "  " << compareFrames(images[0], images[1].data()).pixelsOff << std::endl;
+    };
+
+    std::cout << "scene  uncached_shadow_mrays  cached_shadow_mrays  speedup  uncached_ms  cached_ms  differing_pixels" << std::endl;
+    bool voxel = useVoxelWorld;
+    for (bool voxelDiorama : {false, true}) {
+        useVoxelWorld = voxelDiorama;
+        loadScene();
+        measure(voxelDiorama ? "diorama-voxel" : "diorama");
+        clearScene();
+    }
+    useVoxelWorld = voxel;
+    setUpRandomBlocks(90000, 10000);
+    measure("blocks-100k");
+    clearScene();
+    setUpTerrain(512);
+    measure("terrain-512");
+    occluderCache = true;
+    return 0;
+}
+
+// Lava field with 1 to 1000 lights: frame time and shadow rays per frame when each hit
+// samples lightSamples lights from the light tree, against summing every light (up to
+// 100 lights, beyond which it takes minutes per frame). mean_error is the mean
+// per-channel difference (0-255) of the sampled image from the summed one: the noise.
+int benchmarkLights(int frames) {
+    ThreadPool pool(threadCount);
+    int samples = lightSamples > 0 ? lightSamples : 1;
+    auto time = [&](double& ms, unsigned long long& shadowRaysPerFrame) {
+        render(pool); // warm-up
+        resetRayStats();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            render(pool);
+        }
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        shadowRaysPerFrame = rayStats().shadow / frames;
+    };
+
+    std::cout << "lights  sampled_ms  sampled_shadow_rays  every_light_ms  every_light_shadow_rays  mean_error" << std::endl;
+    for (int lightCount : {1, 10, 100, 1000}) {
+        setUpLavaField(lightCount);
+        double sampledMs;
+        unsigned long long sampledShadows;
+        lightSamples = samples;
+        time(sampledMs, sampledShadows);
+        std::cout << lightCount << "  " << sampledMs << "  " << sampledShadows;
+        if (lightCount > 100) {
+            std::cout << "  -  -  -" << std::endl;
+            clearScene();
+            continue;
+        }
+        std::vector<Uint32> sampled(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+
+        double everyMs;
+        unsigned long long everyShadows;
+        lightSamples = 0;
+        time(everyMs, everyShadows);
+        std::cout << "  " << everyMs << "  " << everyShadows << "  " << compareFrames(sampled, framebuffer.data()).mean << std::endl;
+        clearScene();
+    }
+    lightSamples = samples;
+    return 0;
+}
+
+// Uniform supersampling against AdaptiveSampler on the diorama, the glass scene and
+// 100k blocks: frame time, samples per pixel, and against 32 uniform samples the mean
+// per-channel difference (0-255) and the share of pixels off by more than 8 in a channel.
+int benchmarkAdaptive(int frames, float threshold) {
+    ThreadPool pool(threadCount);
+    int samples = samplesPerPixel;
+    auto measure = [&](const std::string& sceneName) {
+        samplesPerPixel = 32;
+        render(pool);
+        std::vector<Uint32> reference(framebuffer.data(), framebuffer.data() + static_cast<size_t>(screenWidth) * screenHeight);
+
+        auto report = [&](const std::string& method, double ms, double averageSamples) {
+            ImageDifference difference = compareFrames(reference, framebuffer.data(), 8);
+            std::cout << sceneName << "  " << method << "  " << ms << "  " << averageSamples << "  " << difference.mean << "  "
+                      << 100.0 * difference.pixelsOff / reference.size() << std::endl;
+        };
+
+        for (int uniform : {1, 4, 8}) {
+            samplesPerPixel = uniform;
+            render(pool); // warm-up
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                render(pool);
+            }
+            report("uniform-" + std::to_string(uniform), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames, uniform);
+        }
+        samplesPerPixel = 1;
+        for (int maxSamples : {4, 8, 16}) {
+            AdaptiveSampler adaptive(maxSamples, threshold);
+            adaptive.render(pool); // warm-up
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                adaptive.render(pool);
+            }
+            report("adaptive-" + std::to_string(maxSamples), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames,
+                   adaptive.averageSamples());
+        }
+    };
+
+    std::cout << "scene  method  ms  spp  mean_error  pixels_off_%" << std::endl;
+    loadScene();
+    measure("diorama");
+    clearScene();
+    setUpGlassScene();
+    measure("glass");
+    clearScene();
+    setUpRandomBlocks(90000, 10000);
+    measure("blocks-100k");
+    samplesPerPixel = samples;
+    return 0;
+}
+
+int runBenchmark(const RenderOptions& options) {
+    if (options.mode == "bench-threads") {
+        return benchmarkThreads(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-bvh") {
+        return benchmarkBVH();
+    }
+    if (options.mode == "bench-layout") {
+        return benchmarkSceneLayout();
+    }
+    if (options.mode == "bench-slab") {
+        return benchmarkSlab();
+    }
+    if (options.mode == "bench-packets") {
+        return benchmarkPackets(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-textures") {
+        return benchmarkTextures(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-skybox") {
+        return benchmarkSkybox(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-progressive") {
+        return benchmarkProgressive(options.maxSamples);
+    }
+    if (options.mode == "bench-reprojection") {
+        return benchmarkReprojection(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-relight") {
+        return benchmarkRelight(options.modeArgument.value_or(5));
+    }
+    if (options.mode == "bench-depth") {
+        return benchmarkDepth(options.modeArgument.value_or(3));
+    }
+    if (options.mode == "bench-wavefront") {
+        return benchmarkWavefront(options.modeArgument.value_or(3));
+    }
+    if (options.mode == "bench-shadows") {
+        return benchmarkShadows(options.modeArgument.value_or(3));
+    }
+    if (options.mode == "bench-lights") {
+        return benchmarkLights(options.modeArgument.value_or(3));
+    }
+    if (options.mode == "bench-adaptive") {
+        return benchmarkAdaptive(options.modeArgument.value_or(3), options.adaptiveThreshold);
+    }
+    if (options.mode == "bench-bricks") {
+        return benchmarkBricks(options.modeArgument.value_or(1024));
+    }
+    if (options.mode == "bench-streaming") {
+        return benchmarkStreaming(options.modeArgument.value_or(2048));
+    }
+    if (options.mode == "bench-voxel") {
+        return benchmarkVoxelWorld(options.modeArgument.value_or(256));
+    }
+    std::cerr << "unknown benchmark '--" << options.mode << "'" << std::endl;
+    printUsage(std::cerr);
+    return 2;
+}
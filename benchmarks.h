@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include "options.h"
+
+// The --bench-* modes of RaytracingBenchmark. Each prints a table on stdout; the
+// render settings in options have already been applied. Returns the process exit
+// code, 2 for an unknown mode.
+int runBenchmark(const RenderOptions& options);
+
+// Peak resident set size of the process so far
+size_t peakMemoryBytes();
+// Current resident set size of the process
+size_t residentMemoryBytes();
@@ -0,0 +1,185 @@
+#include "bvh.h"
+#include <algorithm>
+
+namespace {
+    const int BIN_COUNT = 12;
+    const int MAX_LEAF_SIZE = 4;
+}
+
+void BVH::build(const std::vector<AABB>& primitiveBounds, const std::vector<int>& leafKeys) {
+    nodes.clear();
+    primitiveOrder.resize(primitiveBounds.size());
+    for (size_t i = 0; i < primitiveOrder.size(); i++) {
+        primitiveOrder[i] = static_cast<int>(i);
+    }
+
+    if (primitiveBounds.empty()) {
+        return;
+    }
+
+    // Partitioned alongside primitiveOrder while the tree is built
+    std::vector<AABB> slotBounds = primitiveBounds;
+    std::vector<int> slotKeys = leafKeys.empty() ? std::vector<int>(primitiveBounds.size(), 0) : leafKeys;
+
+    // A leaf is at most maxSplitDepth levels down plus one per key that still has to be
+    // split off, and a traversal holds at most one entry more than the deepest leaf
+    std::vector<int> distinctKeys = slotKeys;
+    std::sort(distinctKeys.begin(), distinctKeys.end());
+    int keyCount = static_cast<int>(std::unique(distinctKeys.begin(), distinctKeys.end()) - distinctKeys.begin());
+    maxSplitDepth = std::max(0, STACK_SIZE - keyCount);
+
+    nodes.reserve(2 * primitiveBounds.size());
+    Node root;
+    root.leftFirst = 0;
+    root.count = static_cast<int>(primitiveBounds.size());
+    nodes.push_back(root);
+    subdivide(0, 0, slotBounds, slotKeys);
+}
+
+void BVH::subdivide(int nodeIndex, int depth, std::vector<AABB>& primitiveBounds, std::vector<int>& primitiveKeys) {
+    int first = nodes[nodeIndex].leftFirst;
+    int count = nodes[nodeIndex].count;
+
+    AABB bounds;
+    AABB centroidBounds;
+    for (int i = first; i < first + count; i++) {
+        bounds.expand(primitiveBounds[i]);
+        centroidBounds.expand(primitiveBounds[i].center());
+    }
+    nodes[nodeIndex].bounds = bounds;
+
+    bool mixedKeys = std::any_of(primitiveKeys.begin() + first, primitiveKeys.begin() + first + count,
+                                 [&](int key) { return key != primitiveKeys[first]; });
+    if ((count <= MAX_LEAF_SIZE || depth >= maxSplitDepth) && !mixedKeys) {
+        return;
+    }
+
+    // Binned SAH: try BIN_COUNT - 1 split planes per axis over the centroid extent
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = bounds.surfaceArea() * count;
+
+    for (int axis = 0; axis < 3 && depth < maxSplitDepth; axis++) {
+        float axisMin = centroidBounds.min[axis];
+        float axisExtent = centroidBounds.max[axis] - axisMin;
+        if (axisExtent <= 0.0f) {
+            continue;
+        }
+
+        AABB binBounds[BIN_COUNT];
+        int binCount[BIN_COUNT] = {};
+        float scale = BIN_COUNT / axisExtent;
+        for (int i = first; i < first + count; i++) {
+            int bin = std::min(BIN_COUNT - 1, static_cast<int>((primitiveBounds[i].center()[axis] - axisMin) * scale));
+            binBounds[bin].expand(primitiveBounds[i]);
+            binCount[bin]++;
+        }
+
+        float leftArea[BIN_COUNT - 1];
+        int leftCount[BIN_COUNT - 1];
+        AABB leftBox;
+        int leftSum = 0;
+        for (int i = 0; i < BIN_COUNT - 1; i++) {
+            leftBox.expand(binBounds[i]);
+            leftSum += binCount[i];
+            leftArea[i] = leftBox.isEmpty() ? 0.0f : leftBox.surfaceArea();
+            leftCount[i] = leftSum;
+        }
+
+        AABB rightBox;
+        int rightSum = 0;
+        for (int i = BIN_COUNT - 1; i > 0; i--) {
+            rightBox.expand(binBounds[i]);
+            rightSum += binCount[i];
+            float rightArea = rightBox.isEmpty() ? 0.0f : rightBox.surfaceArea();
+            float cost = leftArea[i - 1] * leftCount[i - 1] + rightArea * rightSum;
+            if (leftCount[i - 1] > 0 && rightSum > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    if (bestAxis == -1 && !mixedKeys) {
+        return;
+    }
+
+    // Partition primitives (and their cached bounds and keys) around the chosen plane,
+    // or by key when no plane works but the leaf would mix keys
+    int firstKey = primitiveKeys[first];
+    int i = first;
+    while (true) {
+        float axisMin = bestAxis == -1 ? 0.0f : centroidBounds.min[bestAxis];
+        float scale = bestAxis == -1 ? 0.0f : BIN_COUNT / (centroidBounds.max[bestAxis] - axisMin);
+        auto goesLeft = [&](int slot) {
+            if (bestAxis == -1) {
+                return primitiveKeys[slot] == firstKey;
+            }
+            int bin = std::min(BIN_COUNT - 1, static_cast<int>((primitiveBounds[slot].center()[bestAxis] - axisMin) * scale));
+            return bin < bestSplit;
+        };
+
+        i = first;
+        int j = first + count - 1;
+        while (i <= j) {
+            if (goesLeft(i)) {
+                i++;
+            } else {
+                std::swap(primitiveOrder[i], primitiveOrder[j]);
+                std::swap(primitiveBounds[i], primitiveBounds[j]);
+                std::swap(primitiveKeys[i], primitiveKeys[j]);
+                j--;
+            }
+        }
+
+        bool degenerate = i == first || i == first + count;
+        if (!degenerate) {
+            break;
+        }
+        if (bestAxis == -1 || !mixedKeys) {
+            return;
+        }
+        bestAxis = -1;
+    }
+
+    int leftCountFinal = i - first;
+
+    int leftIndex = static_cast<int>(nodes.size());
+    Node left;
+    left.leftFirst = first;
+    left.count = leftCountFinal;
+    Node right;
+    right.leftFirst = i;
+    right.count = count - leftCountFinal;
+    nodes.push_back(left);
+    nodes.push_back(right);
+
+    nodes[nodeIndex].leftFirst = leftIndex;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(leftIndex, depth + 1, primitiveBounds, primitiveKeys);
+    subdivide(leftIndex + 1, depth + 1, primitiveBounds, primitiveKeys);
+}
+
+void BVH::refit(const std::vector<AABB>& primitiveBounds) {
+    if (!nodes.empty()) {
+        refitNode(0, primitiveBounds);
+    }
+}
+
+void BVH::refitNode(int nodeIndex, const std::vector<AABB>& primitiveBounds) {
+    Node& node = nodes[nodeIndex];
+    AABB bounds;
+    if (node.isLeaf()) {
+        for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+            bounds.expand(primitiveBounds[primitiveOrder[i]]);
+        }
+    } else {
+        refitNode(node.leftFirst, primitiveBounds);
+        refitNode(node.leftFirst + 1, primitiveBounds);
+        bounds.expand(nodes[node.leftFirst].bounds);
+        bounds.expand(nodes[node.leftFirst + 1].bounds);
+    }
+    nodes[nodeIndex].bounds = bounds;
+}
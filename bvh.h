@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "ray.h"
+
+// Bounding volume hierarchy over primitive bounds, built with binned SAH.
+// Nodes are stored flat; an interior node's children sit at leftFirst and leftFirst + 1.
+// Leaves cover a contiguous range of tree slots; getPrimitiveOrder() maps a slot back
+// to the index the primitive had in build(), so callers can store their data in slot order.
+// When leaf keys are given, a leaf never mixes primitives with different keys.
+// Traversal keeps pending nodes on a fixed stack of STACK_SIZE entries, so build()
+// stops splitting by cost deep enough that no leaf lies more than STACK_SIZE - 1
+// levels down; deeper primitives share larger leaves.
+class BVH {
+public:
+    static constexpr float NO_HIT = std::numeric_limits<float>::max();
+
+    void build(const std::vector<AABB>& primitiveBounds, const std::vector<int>& leafKeys = {});
+
+    // Recomputes node bounds after primitives moved, keeping the tree topology.
+    // Bounds are indexed like in build(). Call build() again when the motion is large.
+    void refit(const std::vector<AABB>& primitiveBounds);
+
+    const std::vector<int>& getPrimitiveOrder() const { return primitiveOrder; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t memoryFootprint() const { return nodes.capacity() * sizeof(Node) + primitiveOrder.capacity() * sizeof(int); }
+
+    // Visits leaves front to back as intersectLeaf(first, count, tMax). The callback
+    // lowers tMax when it finds a closer hit, which prunes the rest of the traversal.
+    template<typename LeafFunction>
+    void closestHit(const Ray& ray, float& tMax, LeafFunction&& intersectLeaf) const;
+
+    // Stops at the first leaf for which intersectLeaf(first, count) returns true; nodes
+    // the ray enters at or beyond tMax are skipped
+    template<typename LeafFunction>
+    bool anyHit(const Ray& ray, float tMax, LeafFunction&& intersectLeaf) const;
+
+    // Packet traversal. intersectNode(bounds, laneMask) returns the lanes that enter a
+    // node (bounds points at min xyz, max xyz); intersectLeaf(first, count, laneMask)
+    // returns lanes that are finished, which stop taking part. Children are visited
+    // nearest first along orderDirection; a zero direction keeps the anyHit() order.
+    template<typename NodeFunction, typename LeafFunction>
+    void traversePacket(unsigned int activeMask, const glm::vec3& orderDirection,
+                        NodeFunction&& intersectNode, LeafFunction&& intersectLeaf) const;
+
+    // Entry distance of the ray into the box, or NO_HIT if it misses or starts past tMax
+    static float intersectBounds(const AABB& bounds, const Ray& ray, float tMax) {
+        const glm::vec3* corners[2] = {&bounds.min, &bounds.max};
+
+        float tNear = (corners[ray.sign[0]]->x - ray.origin.x) * ray.invDirection.x;
+        float tFar = (corners[1 - ray.sign[0]]->x - ray.origin.x) * ray.invDirection.x;
+        float tyNear = (corners[ray.sign[1]]->y - ray.origin.y) * ray.invDirection.y;
+        float tyFar = (corners[1 - ray.sign[1]]->y - ray.origin.y) * ray.invDirection.y;
+        float tzNear = (corners[ray.sign[2]]->z - ray.origin.z) * ray.invDirection.z;
+        float tzFar = (corners[1 - ray.sign[2]]->z - ray.origin.z) * ray.invDirection.z;
+
+        tNear = std::max(std::max(tNear, tyNear), tzNear);
+        tFar = std::min(std::min(tFar, tyFar), tzFar);
+
+        if (tNear <= tFar && tFar >= 0.0f && tNear < tMax) {
+            return tNear;
+        }
+        return NO_HIT;
+    }
+
+private:
+    static const int STACK_SIZE = 64;
+
+    struct Node {
+        AABB bounds;
+        int leftFirst = 0;
+        int count = 0;
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    void subdivide(int nodeIndex, int depth, std::vector<AABB>& slotBounds, std::vector<int>& slotKeys);
+    void refitNode(int nodeIndex, const std::vector<AABB>& primitiveBounds);
+
+    std::vector<Node> nodes;
+    std::vector<int> primitiveOrder;
+    // Nodes this deep are only split to separate keys
+    int maxSplitDepth = 0;
+};
+
+template<typename LeafFunction>
+void BVH::closestHit(const Ray& ray, float& tMax, LeafFunction&& intersectLeaf) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    if (intersectBounds(nodes[0].bounds, ray, tMax) == NO_HIT) {
+        return;
+    }
+
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    int nodeIndex = 0;
+
+    while (true) {
+        const Node& node = nodes[nodeIndex];
+        if (node.isLeaf()) {
+            intersectLeaf(node.leftFirst, node.count, tMax);
+        } else {
+            // Visit the nearer child first and keep the other for later
+            int nearChild = node.leftFirst;
+            int farChild = node.leftFirst + 1;
+            float tNear = intersectBounds(nodes[nearChild].bounds, ray, tMax);
+            float tFar = intersectBounds(nodes[farChild].bounds, ray, tMax);
+            if (tFar < tNear) {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+
+            if (tNear != NO_HIT) {
+                if (tFar != NO_HIT) {
+                    assert(stackSize < STACK_SIZE);
+                    stack[stackSize++] = farChild;
+                }
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        // Pop, skipping subtrees that start behind the current closest hit
+        bool found = false;
+        while (stackSize > 0) {
+            nodeIndex = stack[--stackSize];
+            if (intersectBounds(nodes[nodeIndex].bounds, ray, tMax) != NO_HIT) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return;
+        }
+    }
+}
+
+template<typename LeafFunction>
+bool BVH::anyHit(const Ray& ray, float tMax, LeafFunction&& intersectLeaf) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (intersectBounds(node.bounds, ray, tMax) == NO_HIT) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            if (intersectLeaf(node.leftFirst, node.count)) {
+                return true;
+            }
+        } else {
+            assert(stackSize + 2 <= STACK_SIZE);
+            stack[stackSize++] = node.leftFirst + 1;
+            stack[stackSize++] = node.leftFirst;
+        }
+    }
+
+    return false;
+}
+
+template<typename NodeFunction, typename LeafFunction>
+void BVH::traversePacket(unsigned int activeMask, const glm::vec3& orderDirection,
+                         NodeFunction&& intersectNode, LeafFunction&& intersectLeaf) const {
+    if (nodes.empty() || activeMask == 0) {
+        return;
+    }
+
+    static_assert(sizeof(AABB) == 6 * sizeof(float), "node bounds are passed as six packed floats");
+
+    // Each entry keeps the lanes that entered its parent
+    int stack[STACK_SIZE];
+    unsigned int stackMask[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize] = 0;
+    stackMask[stackSize++] = activeMask;
+
+    while (stackSize > 0) {
+        stackSize--;
+        const Node& node = nodes[stack[stackSize]];
+        unsigned int laneMask = stackMask[stackSize] & activeMask;
+        if (laneMask == 0) {
+            continue;
+        }
+        // Tested on pop so that lanes which found a closer hit meanwhile drop out
+        laneMask = intersectNode(&node.bounds.min.x, laneMask);
+        if (laneMask == 0) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            activeMask &= ~intersectLeaf(node.leftFirst, node.count, laneMask);
+            if (activeMask == 0) {
+                return;
+            }
+        } else {
+            assert(stackSize + 2 <= STACK_SIZE);
+            int nearChild = node.leftFirst;
+            int farChild = node.leftFirst + 1;
+            if (glm::dot(nodes[farChild].bounds.center() - nodes[nearChild].bounds.center(), orderDirection) < 0.0f) {
+                std::swap(nearChild, farChild);
+            }
+            stack[stackSize] = farChild;
+            stackMask[stackSize++] = laneMask;
+            stack[stackSize] = nearChild;
+            stackMask[stackSize++] = laneMask;
+        }
+    }
+}
@@ -0,0 +1,300 @@
+#include "chunkstream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[4] = {'V', 'X', 'C', 'K'};
+    const Uint32 VERSION = 3;
+    const size_t PAGE_STRIDE = 4096;
+
+    glm::ivec3 chunksFor(const glm::ivec3& size) {
+        return (size + glm::ivec3(ChunkStream::CHUNK_SIZE - 1)) / ChunkStream::CHUNK_SIZE;
+    }
+}
+
+ChunkStream::ChunkStream(const std::string& path, size_t residentBudget) : file(path), budget(residentBudget) {
+    if (file.size() < sizeof(Header) || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a chunk file");
+    }
+    header = reinterpret_cast<const Header*>(file.data());
+    if (header->version != VERSION) {
+        throw std::runtime_error(path + ": unsupported chunk file version " + std::to_string(header->version));
+    }
+    if (header->size[0] < 1 || header->size[1] < 1 || header->size[2] < 1) {
+        throw std::runtime_error(path + " is corrupt");
+    }
+    if (header->chunkAlignment == 0 || header->chunkAlignment % MappedFile::pageSize() != 0) {
+        throw std::runtime_error(path + ": chunks are aligned to " + std::to_string(header->chunkAlignment) + " bytes, not to the " +
+                                 std::to_string(MappedFile::pageSize()) + " byte pages here");
+    }
+    chunksSize = chunksFor(getSize());
+    chunkCount = static_cast<size_t>(chunksSize.x) * chunksSize.y * chunksSize.z;
+    size_t chunksStart = sizeof(Header) + chunkCount * sizeof(Uint64);
+    if (file.size() < chunksStart) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    directory = reinterpret_cast<const Uint64*>(file.data() + sizeof(Header));
+    states = std::make_unique<ChunkState[]>(chunkCount);
+
+    // Checked once here, so that rays can index the chunks without bounds checks
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        Uint64 offset = directory[chunk];
+        if (offset & UNIFORM_CHUNK) {
+            if (static_cast<Uint8>(offset) >= header->materialCount) {
+                throw std::runtime_error(path + ": chunk " + std::to_string(chunk) + " holds an unknown material");
+            }
+            continue;
+        }
+        if (offset < chunksStart || offset % header->chunkAlignment != 0 || offset + BRICKS_PER_CHUNK * sizeof(Uint32) > file.size()) {
+            throw std::runtime_error(path + ": chunk " + std::to_string(chunk) + " has a bad offset");
+        }
+        try {
+            states[chunk].bytes = static_cast<Uint32>(chunkBytes(chunk));
+        } catch (const std::runtime_error& error) {
+            throw std::runtime_error(path + ": " + error.what());
+        }
+        // Not to hold the whole file while checking it
+        file.release(static_cast<size_t>(offset), states[chunk].bytes);
+    }
+    // Reading the chunks paged them in, along with the pages the OS maps around a fault
+    file.release(chunksStart, file.size() - chunksStart);
+    prefetcher = std::thread(&ChunkStream::prefetchLoop, this);
+}
+
+ChunkStream::~ChunkStream() {
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        stopping = true;
+    }
+    prefetchWake.notify_one();
+    prefetcher.join();
+}
+
+void ChunkStream::prefetch(const glm::vec3& eye, const glm::vec3& forward, float halfAngle, float distance) {
+    frame++;
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        request = PrefetchRequest{eye - glm::vec3(getOrigin()), forward, halfAngle, distance};
+        requested = true;
+    }
+    prefetchWake.notify_one();
+}
+
+size_t ChunkStream::chunkBytes(size_t chunk) const {
+    size_t offset = static_cast<size_t>(directory[chunk]);
+    const Uint32* bricks = reinterpret_cast<const Uint32*>(file.data() + offset);
+    size_t denseBricks = 0;
+    for (int i = 0; i < BRICKS_PER_CHUNK; i++) {
+        denseBricks += !(bricks[i] & UNIFORM_BRICK);
+    }
+    Uint8 highestId = 0;
+    for (int i = 0; i < BRICKS_PER_CHUNK; i++) {
+        if (bricks[i] & UNIFORM_BRICK) {
+            highestId = std::max(highestId, static_cast<Uint8>(bricks[i]));
+        } else if (bricks[i] >= denseBricks) {
+            throw std::runtime_error("chunk " + std::to_string(chunk) + " has a brick past its " + std::to_string(denseBricks) + " dense bricks");
+        }
+    }
+    size_t alignment = static_cast<size_t>(header->chunkAlignment);
+    size_t bytes = (BRICKS_PER_CHUNK * sizeof(Uint32) + denseBricks * BRICK_CELLS + alignment - 1) / alignment * alignment;
+    if (bytes > file.size() - offset) {
+        throw std::runtime_error("chunk " + std::to_string(chunk) + " runs past the end of the file");
+    }
+    const Uint8* cells = file.data() + offset + BRICKS_PER_CHUNK * sizeof(Uint32);
+    if (denseBricks > 0) {
+        highestId = std::max(highestId, *std::max_element(cells, cells + denseBricks * BRICK_CELLS));
+    }
+    if (highestId >= header->materialCount) {
+        throw std::runtime_error("chunk " + std::to_string(chunk) + " holds material ID " + std::to_string(highestId) + ", past the file's " +
+                                 std::to_string(header->materialCount) + " materials");
+    }
+    return bytes;
+}
+
+void ChunkStream::pageIn(size_t chunk) const {
+    std::lock_guard<std::mutex> lock(pagingMutex);
+    ChunkState& state = states[chunk];
+    if (state.resident.load(std::memory_order_relaxed)) {
+        return;
+    }
+    state.resident.store(true, std::memory_order_release);
+    residentChunks.push_back(static_cast<Uint32>(chunk));
+    resident += state.bytes;
+    pagedIn++;
+    if (resident > budget) {
+        evict();
+    }
+}
+
+void ChunkStream::evict() const {
+    // In batches, so that the sort is rare
+    std::sort(residentChunks.begin(), residentChunks.end(), [this](Uint32 a, Uint32 b) {
+        return states[a].lastUsed.load(std::memory_order_relaxed) < states[b].lastUsed.load(std::memory_order_relaxed);
+    });
+    size_t kept = 0;
+    while (kept < residentChunks.size() && resident > budget / 4 * 3) {
+        Uint32 chunk = residentChunks[kept++];
+        size_t bytes = states[chunk].bytes;
+        states[chunk].resident.store(false, std::memory_order_relaxed);
+        resident -= bytes;
+        evicted++;
+    }
+    residentChunks.erase(residentChunks.begin(), residentChunks.begin() + kept);
+
+    // Releases all but the chunks kept: a fault also maps the pages around it, which may
+    // belong to chunks never paged in
+    std::sort(residentChunks.begin(), residentChunks.end(), [this](Uint32 a, Uint32 b) { return directory[a] < directory[b]; });
+    size_t start = sizeof(Header) + chunkCount * sizeof(Uint64);
+    for (Uint32 chunk : residentChunks) {
+        size_t offset = static_cast<size_t>(directory[chunk]);
+        file.release(start, offset - start);
+        start = offset + states[chunk].bytes;
+    }
+    file.release(start, file.size() - start);
+}
+
+void ChunkStream::prefetchLoop() {
+    std::vector<std::pair<float, Uint32>> candidates;
+    while (true) {
+        PrefetchRequest current;
+        {
+            std::unique_lock<std::mutex> lock(prefetchMutex);
+            prefetchWake.wait(lock, [this] { return requested || stopping; });
+            if (stopping) {
+                return;
+            }
+            current = request;
+            requested = false;
+        }
+
+        // Chunks whose bounding sphere is within distance and touches the view cone
+        const float radius = 0.8660254f * CHUNK_SIZE;
+        glm::ivec3 first = glm::max(glm::ivec3(glm::floor((current.eye - current.distance) / static_cast<float>(CHUNK_SIZE))), glm::ivec3(0));
+        glm::ivec3 last = glm::min(glm::ivec3(glm::floor((current.eye + current.distance) / static_cast<float>(CHUNK_SIZE))), chunksSize - 1);
+        candidates.clear();
+        for (int z = first.z; z <= last.z; z++) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    size_t chunk = chunkIndex(x, y, z);
+                    if (directory[chunk] & UNIFORM_CHUNK) {
+                        continue;
+                    }
+                    glm::vec3 toChunk = (glm::vec3(x, y, z) + 0.5f) * static_cast<float>(CHUNK_SIZE) - current.eye;
+                    float dist = glm::length(toChunk);
+                    if (dist - radius > current.distance) {
+                        continue;
+                    }
+                    if (dist > radius) {
+                        float angle = std::acos(std::clamp(glm::dot(toChunk, current.forward) / dist, -1.0f, 1.0f));
+                        if (angle - std::asin(radius / dist) > current.halfAngle) {
+                            continue;
+                        }
+                    }
+                    candidates.emplace_back(dist, static_cast<Uint32>(chunk));
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        // Marked as used this frame, so that paging them in doesn't evict each other
+        Uint32 now = frame.load(std::memory_order_relaxed);
+        size_t loaded = 0;
+        for (const auto& [dist, chunk] : candidates) {
+            {
+                std::lock_guard<std::mutex> lock(prefetchMutex);
+                if (requested || stopping) {
+                    break;
+                }
+            }
+            size_t offset = static_cast<size_t>(directory[chunk]);
+            size_t bytes = states[chunk].bytes;
+            loaded += bytes;
+            if (loaded > budget / 2) {
+                break;
+            }
+            states[chunk].lastUsed.store(now, std::memory_order_relaxed);
+            if (states[chunk].resident.load(std::memory_order_acquire)) {
+                continue;
+            }
+            file.willNeed(offset, bytes);
+            // Reading a byte of every page faults the chunk in here rather than in a ray
+            volatile Uint8 sink = 0;
+            for (size_t page = 0; page < bytes; page += PAGE_STRIDE) {
+                sink = sink ^ file.data()[offset + page];
+            }
+            pageIn(chunk);
+        }
+    }
+}
+
+ChunkWriter::ChunkWriter(const std::string& path, const glm::ivec3& origin, const glm::ivec3& size)
+        : path(path), file(path, std::ios::binary | std::ios::trunc), chunksSize(chunksFor(size)) {
+    if (!file) {
+        throw std::runtime_error("Unable to create " + path);
+    }
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    for (int axis = 0; axis < 3; axis++) {
+        header.origin[axis] = origin[axis];
+        header.size[axis] = size[axis];
+    }
+    header.blockCount = 0;
+    header.chunkAlignment = MappedFile::pageSize();
+    // Empty cells
+    header.materialCount = 1;
+    directory.assign(static_cast<size_t>(chunksSize.x) * chunksSize.y * chunksSize.z, Uint64(ChunkStream::UNIFORM_CHUNK));
+
+    // Header and directory are written last; chunks go after them
+    file.seekp(static_cast<std::streamoff>(sizeof(ChunkStream::Header) + directory.size() * sizeof(Uint64)));
+}
+
+void ChunkWriter::addChunk(const glm::ivec3& chunkMin, const Uint32* bricks, const Uint8* cells, size_t blockCount) {
+    glm::ivec3 chunk = (chunkMin - glm::ivec3(header.origin[0], header.origin[1], header.origin[2])) / ChunkStream::CHUNK_SIZE;
+    size_t index = static_cast<size_t>(chunk.x) + static_cast<size_t>(chunksSize.x) * (static_cast<size_t>(chunk.y) + static_cast<size_t>(chunksSize.y) * chunk.z);
+    header.blockCount += blockCount;
+
+    size_t denseBricks = 0;
+    bool uniform = true;
+    Uint8 highestId = 0;
+    for (int i = 0; i < ChunkStream::BRICKS_PER_CHUNK; i++) {
+        denseBricks += !(bricks[i] & ChunkStream::UNIFORM_BRICK);
+        uniform = uniform && bricks[i] == bricks[0];
+        if (bricks[i] & ChunkStream::UNIFORM_BRICK) {
+            highestId = std::max(highestId, static_cast<Uint8>(bricks[i]));
+        }
+    }
+    if (denseBricks > 0) {
+        highestId = std::max(highestId, *std::max_element(cells, cells + denseBricks * ChunkStream::BRICK_CELLS));
+    }
+    header.materialCount = std::max<Uint64>(header.materialCount, highestId + 1u);
+    if (uniform && denseBricks == 0) {
+        directory[index] = ChunkStream::UNIFORM_CHUNK | static_cast<Uint8>(bricks[0]);
+        return;
+    }
+
+    pad();
+    directory[index] = static_cast<Uint64>(file.tellp());
+    file.write(reinterpret_cast<const char*>(bricks), ChunkStream::BRICKS_PER_CHUNK * sizeof(Uint32));
+    file.write(reinterpret_cast<const char*>(cells), static_cast<std::streamsize>(denseBricks * ChunkStream::BRICK_CELLS));
+}
+
+void ChunkWriter::pad() {
+    size_t alignment = static_cast<size_t>(header.chunkAlignment);
+    size_t padding = (alignment - static_cast<size_t>(file.tellp()) % alignment) % alignment;
+    const std::vector<char> zeros(padding);
+    file.write(zeros.data(), static_cast<std::streamsize>(padding));
+}
+
+void ChunkWriter::finish() {
+    // The last chunk is padded like the others
+    pad();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(ChunkStream::Header));
+    file.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size() * sizeof(Uint64)));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Error writing " + path);
+    }
+}
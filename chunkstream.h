@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "glm/glm.hpp"
+#include "mappedfile.h"
+
+// A chunk file mapped into memory and paged in as rays first touch its chunks. Touched
+// chunks count against a budget of resident bytes; past it, the least recently used
+// ones go back to the OS, to be read from the file again if a ray returns. A
+// background thread loads the chunks in and around the camera's view ahead of the rays.
+//
+// The file holds a header, a directory with one entry per CHUNK_SIZE^3 chunk, then the
+// chunks that aren't one ID throughout. A directory entry is UNIFORM_CHUNK | ID or the
+// file offset of the chunk. A chunk is the entries of its BRICKS_PER_CHUNK bricks
+// (UNIFORM_BRICK | ID, or the index of one of the chunk's dense bricks) followed by
+// BRICK_CELLS IDs per dense brick, in VoxelWorld's brick and cell order. Chunks start
+// on multiples of the header's chunkAlignment, a whole number of pages of the writing
+// machine, and are padded to the next one, so that evicting a chunk frees all of it.
+// Materials aren't stored; materialCount is one past the highest ID the chunks use.
+class ChunkStream {
+public:
+    static const int BRICK_SHIFT = 3;
+    static const int CHUNK_SHIFT = 5;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static const int BRICKS_PER_AXIS = CHUNK_SIZE >> BRICK_SHIFT;
+    static const int BRICKS_PER_CHUNK = BRICKS_PER_AXIS * BRICKS_PER_AXIS * BRICKS_PER_AXIS;
+    static const int BRICK_CELLS = 1 << (3 * BRICK_SHIFT);
+    static const Uint32 UNIFORM_BRICK = 0x80000000u;
+    static const Uint64 UNIFORM_CHUNK = 1ull << 63;
+
+    struct Header {
+        char magic[4];
+        Uint32 version;
+        Sint32 origin[3];
+        Sint32 size[3];
+        Uint64 blockCount;
+        Uint64 chunkAlignment;
+        Uint64 materialCount;
+    };
+
+    // Index of brick (x, y, z) of a chunk, in bricks
+    static int brickInChunk(int x, int y, int z) {
+        return x + BRICKS_PER_AXIS * (y + BRICKS_PER_AXIS * z);
+    }
+
+    // Throws std::runtime_error when the file can't be mapped, isn't a chunk file, is
+    // corrupt or aligns its chunks to less than a page here. Reads every chunk once.
+    ChunkStream(const std::string& path, size_t residentBudget);
+    // Stops the prefetch thread
+    ~ChunkStream();
+
+    ChunkStream(const ChunkStream&) = delete;
+    ChunkStream& operator=(const ChunkStream&) = delete;
+
+    glm::ivec3 getOrigin() const { return glm::ivec3(header->origin[0], header->origin[1], header->origin[2]); }
+    glm::ivec3 getSize() const { return glm::ivec3(header->size[0], header->size[1], header->size[2]); }
+    size_t blockCount() const { return static_cast<size_t>(header->blockCount); }
+    // The world's material IDs are all below this
+    size_t materialCount() const { return static_cast<size_t>(header->materialCount); }
+
+    // Entry of the brick holding grid cell (x, y, z), which must lie inside the world:
+    // UNIFORM_BRICK | ID, or otherwise cells is set to the brick's IDs
+    Uint32 brick(int x, int y, int z, const Uint8*& cells) const {
+        size_t chunk = chunkIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+        Uint64 entry = directory[chunk];
+        if (entry & UNIFORM_CHUNK) {
+            return UNIFORM_BRICK | static_cast<Uint8>(entry);
+        }
+        touch(chunk);
+        const Uint8* data = file.data() + entry;
+        const int mask = BRICKS_PER_AXIS - 1;
+        Uint32 brick = reinterpret_cast<const Uint32*>(data)[brickInChunk(x >> BRICK_SHIFT & mask, y >> BRICK_SHIFT & mask, z >> BRICK_SHIFT & mask)];
+        if (!(brick & UNIFORM_BRICK)) {
+            cells = data + BRICKS_PER_CHUNK * sizeof(Uint32) + static_cast<size_t>(brick) * BRICK_CELLS;
+        }
+        return brick;
+    }
+
+    // Starts a new frame for the LRU ages, and has the background thread load the
+    // chunks within `distance` of eye and the cone of halfAngle around forward, nearest
+    // first, up to half the budget. Replaces the previous request.
+    void prefetch(const glm::vec3& eye, const glm::vec3& forward, float halfAngle, float distance);
+
+    size_t residentBytes() const { return resident; }
+    size_t residentBudget() const { return budget; }
+    // Chunks paged in and evicted since the file was opened
+    size_t pageIns() const { return pagedIn; }
+    size_t evictions() const { return evicted; }
+    size_t memoryFootprint() const { return sizeof(ChunkStream) + chunkCount * sizeof(ChunkState) + residentChunks.capacity() * sizeof(Uint32) + resident; }
+
+private:
+    struct ChunkState {
+        // Frame of the last touch
+        std::atomic<Uint32> lastUsed{0};
+        std::atomic<bool> resident{false};
+        // Padded size of the chunk in the file
+        Uint32 bytes = 0;
+    };
+
+    struct PrefetchRequest {
+        glm::vec3 eye;
+        glm::vec3 forward;
+        float halfAngle;
+        float distance;
+    };
+
+    size_t chunkIndex(int x, int y, int z) const {
+        return static_cast<size_t>(x) + static_cast<size_t>(chunksSize.x) * (static_cast<size_t>(y) + static_cast<size_t>(chunksSize.y) * z);
+    }
+
+    void touch(size_t chunk) const {
+        ChunkState& state = states[chunk];
+        Uint32 now = frame.load(std::memory_order_relaxed);
+        if (state.lastUsed.load(std::memory_order_relaxed) != now) {
+            state.lastUsed.store(now, std::memory_order_relaxed);
+        }
+        if (!state.resident.load(std::memory_order_acquire)) {
+            pageIn(chunk);
+        }
+    }
+
+    // Counts the chunk as resident, evicting others past the budget
+    void pageIn(size_t chunk) const;
+    // Releases the oldest chunks down to 3/4 of the budget; pagingMutex must be held
+    void evict() const;
+    // Padded size of the chunk; throws std::runtime_error when its brick entries index
+    // past its dense bricks, it runs past the end of the file or holds an ID at or
+    // above materialCount()
+    size_t chunkBytes(size_t chunk) const;
+    void prefetchLoop();
+
+    MappedFile file;
+    const Header* header;
+    const Uint64* directory;
+    glm::ivec3 chunksSize;
+    size_t chunkCount;
+    size_t budget;
+
+    // Bookkeeping of rays that only read the world
+    std::unique_ptr<ChunkState[]> states;
+    mutable std::mutex pagingMutex;
+    mutable std::vector<Uint32> residentChunks;
+    mutable std::atomic<size_t> resident{0};
+    mutable std::atomic<size_t> pagedIn{0};
+    mutable std::atomic<size_t> evicted{0};
+    std::atomic<Uint32> frame{1};
+
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchWake;
+    PrefetchRequest request;
+    bool requested = false;
+    bool stopping = false;
+    std::thread prefetcher;
+};
+
+// Writes a chunk file one chunk at a time, so that a world larger than memory can be
+// generated piece by piece. Chunks never added are empty.
+class ChunkWriter {
+public:
+    // Throws std::runtime_error when the file can't be created
+    ChunkWriter(const std::string& path, const glm::ivec3& origin, const glm::ivec3& size);
+
+    // chunkMin is the chunk's lowest cell in world coordinates. bricks holds its
+    // BRICKS_PER_CHUNK entries; dense ones index the BRICK_CELLS-sized blocks of cells.
+    void addChunk(const glm::ivec3& chunkMin, const Uint32* bricks, const Uint8* cells, size_t blockCount);
+
+    // Writes the directory and closes the file; throws std::runtime_error on a write error
+    void finish();
+
+private:
+    // Writes zeros up to the next chunk boundary
+    void pad();
+
+    std::string path;
+    std::ofstream file;
+    ChunkStream::Header header;
+    glm::ivec3 chunksSize;
+    std::vector<Uint64> directory;
+};
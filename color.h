@@ -19,11 +19,12 @@ struct Color {
         a = static_cast<Uint8>(std::min(std::max(alpha, 0), 255));
     }
 
+    // Clamped before the cast, so values above 1 saturate instead of wrapping
     Color(float red, float green, float blue, float alpha = 1.0f) {
-        r = std::clamp(static_cast<Uint8>(red * 255), Uint8(0), Uint8(255));
-        g = std::clamp(static_cast<Uint8>(green * 255), Uint8(0), Uint8(255));
-        b = std::clamp(static_cast<Uint8>(blue * 255), Uint8(0), Uint8(255));
-        a = std::clamp(static_cast<Uint8>(alpha * 255), Uint8(0), Uint8(255));
+        r = static_cast<Uint8>(std::clamp(red, 0.0f, 1.0f) * 255);
+        g = static_cast<Uint8>(std::clamp(green, 0.0f, 1.0f) * 255);
+        b = static_cast<Uint8>(std::clamp(blue, 0.0f, 1.0f) * 255);
+        a = static_cast<Uint8>(std::clamp(alpha, 0.0f, 1.0f) * 255);
     }
 
     Color(char* none) {
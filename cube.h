@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include "glm/glm.hpp"
 #include "object.h"
+#include "ray.h"
 #include "material.h"
 #include "intersect.h"
 
@@ -11,6 +13,36 @@ public:
 
     Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const override;
 
+    AABB getBounds() const override;
+
+    // Slab test shared with the flattened Scene; tMin is the entry distance, which is
+    // negative when the ray starts inside. Only distances: the surface is evaluated
+    // separately, once, for the hit that ends up closest.
+    static bool slabTest(const glm::vec3& minVertex, const glm::vec3& maxVertex, const Ray& ray, float& tMin) {
+        const glm::vec3* bounds[2] = {&minVertex, &maxVertex};
+
+        float tNear = (bounds[ray.sign[0]]->x - ray.origin.x) * ray.invDirection.x;
+        float tFar = (bounds[1 - ray.sign[0]]->x - ray.origin.x) * ray.invDirection.x;
+        float tyNear = (bounds[ray.sign[1]]->y - ray.origin.y) * ray.invDirection.y;
+        float tyFar = (bounds[1 - ray.sign[1]]->y - ray.origin.y) * ray.invDirection.y;
+        tNear = std::max(tNear, tyNear);
+        tFar = std::min(tFar, tyFar);
+        if (tNear > tFar) {
+            return false;
+        }
+
+        float tzNear = (bounds[ray.sign[2]]->z - ray.origin.z) * ray.invDirection.z;
+        float tzFar = (bounds[1 - ray.sign[2]]->z - ray.origin.z) * ray.invDirection.z;
+        tNear = std::max(tNear, tzNear);
+        tFar = std::min(tFar, tzFar);
+
+        tMin = tNear;
+        return tNear <= tFar && tFar >= 0.0f;
+    }
+
+    // Hit point, face normal and UV for a ray that enters the box at tMin
+    static Intersect surfaceAt(const glm::vec3& minVertex, const glm::vec3& maxVertex,
+                               const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMin);
 
 private:
     glm::vec3 minVertex;
@@ -0,0 +1,129 @@
+#include "framebuffer.h"
+#include <fstream>
+#include <SDL_image.h>
+
+// SSE2 is part of the x86-64 baseline
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAMEBUFFER_SSE2
+#endif
+
+namespace {
+    // Tonemapped [0, 1] value scaled to an index into the sRGB encoding table. The
+    // table is fine enough that neighbouring entries differ by at most one step
+    // except in the darkest tones.
+    const int ENCODE_STEPS = 4096;
+
+    std::array<Uint8, ENCODE_STEPS + 1> makeEncodeTable() {
+        std::array<Uint8, ENCODE_STEPS + 1> table;
+        for (int i = 0; i <= ENCODE_STEPS; i++) {
+            table[i] = linearToSrgb(static_cast<float>(i) / ENCODE_STEPS);
+        }
+        return table;
+    }
+
+    const std::array<Uint8, ENCODE_STEPS + 1> encodeTable = makeEncodeTable();
+
+#ifdef FRAMEBUFFER_SSE2
+    // All four channels of one pixel at once. The result is in [0, 1], and NaN
+    // (from inf / inf) becomes 0 because maxps returns its second operand for NaN.
+    inline __m128 tonemapPixel(__m128 value, Tonemap tonemap) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        value = _mm_max_ps(value, zero);
+        switch (tonemap) {
+            case Tonemap::Reinhard:
+                value = _mm_div_ps(value, _mm_add_ps(one, value));
+                break;
+            case Tonemap::Aces: {
+                __m128 numerator = _mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), value), _mm_set1_ps(0.03f)));
+                __m128 denominator = _mm_add_ps(_mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), value), _mm_set1_ps(0.59f))),
+                                                _mm_set1_ps(0.14f));
+                value = _mm_div_ps(numerator, denominator);
+                break;
+            }
+            default:
+                break;
+        }
+        return _mm_min_ps(_mm_max_ps(value, zero), one);
+    }
+#else
+    float tonemapChannel(float value, Tonemap tonemap) {
+        value = value > 0.0f ? value : 0.0f;
+        switch (tonemap) {
+            case Tonemap::Reinhard:
+                value = value / (1.0f + value);
+                break;
+            case Tonemap::Aces:
+                value = value * (2.51f * value + 0.03f) / (value * (2.43f * value + 0.59f) + 0.14f);
+                break;
+            default:
+                break;
+        }
+        return value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+    }
+#endif
+}
+
+Framebuffer::Framebuffer(int width, int height)
+        : width(width), height(height), radiance(width * height, Radiance(0.0f)), pixels(width * height, 0xFF000000) {}
+
+void Framebuffer::resolve(int x0, int y0, int x1, int y1, Tonemap tonemap, float exposure) {
+    for (int y = y0; y < y1; y++) {
+        resolveRow(y * width + x0, y * width + x1, tonemap, exposure);
+    }
+}
+
+void Framebuffer::resolveRow(int first, int last, Tonemap tonemap, float exposure) {
+    for (int i = first; i < last; i++) {
+        alignas(16) int index[4];
+#ifdef FRAMEBUFFER_SSE2
+        __m128 value = _mm_mul_ps(_mm_loadu_ps(&radiance[i].x), _mm_set1_ps(exposure));
+        value = tonemapPixel(value, tonemap);
+        __m128 scaled = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(static_cast<float>(ENCODE_STEPS))), _mm_set1_ps(0.5f));
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(scaled));
+#else
+        const Radiance& value = radiance[i];
+        index[0] = static_cast<int>(tonemapChannel(value.x * exposure, tonemap) * ENCODE_STEPS + 0.5f);
+        index[1] = static_cast<int>(tonemapChannel(value.y * exposure, tonemap) * ENCODE_STEPS + 0.5f);
+        index[2] = static_cast<int>(tonemapChannel(value.z * exposure, tonemap) * ENCODE_STEPS + 0.5f);
+#endif
+        pixels[i] = Uint32(encodeTable[index[0]]) | Uint32(encodeTable[index[1]]) << 8 | Uint32(encodeTable[index[2]]) << 16 | 0xFF000000;
+    }
+}
+
+bool Framebuffer::writePPM(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<Uint8> row(width * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            Uint32 pixel = pixels[y * width + x];
+            row[x * 3 + 0] = pixel & 0xFF;
+            row[x * 3 + 1] = (pixel >> 8) & 0xFF;
+            row[x * 3 + 2] = (pixel >> 16) & 0xFF;
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+bool Framebuffer::writePNG(const std::string& path) const {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<Uint32*>(pixels.data()), width, height, 32, pitch(), PIXEL_FORMAT);
+    if (surface == nullptr) {
+        std::cerr << "Unable to wrap framebuffer: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    bool written = IMG_SavePNG(surface, path.c_str()) == 0;
+    if (!written) {
+        std::cerr << "Unable to write " << path << ": " << IMG_GetError() << std::endl;
+    }
+    SDL_FreeSurface(surface);
+    return written;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "color.h"
+#include "radiance.h"
+
+// How radiance above 1 is brought into display range
+enum class Tonemap {
+    Clamp,
+    Reinhard,
+    // Narkowicz's fit of the ACES filmic curve
+    Aces
+};
+
+// Linear radiance written by the tracer, and packed RGBA8 pixels
+// (SDL_PIXELFORMAT_ABGR8888) that resolve() derives from it and that are uploaded
+// to a streaming texture in one go.
+class Framebuffer {
+public:
+    static const Uint32 PIXEL_FORMAT = SDL_PIXELFORMAT_ABGR8888;
+
+    Framebuffer(int width, int height);
+
+    void setRadiance(int x, int y, const Radiance& value) {
+        radiance[y * width + x] = value;
+    }
+
+    void setPixel(int x, int y, const Color& color) {
+        pixels[y * width + x] = Uint32(color.r) | Uint32(color.g) << 8 | Uint32(color.b) << 16 | Uint32(color.a) << 24;
+    }
+
+    // Exposure, tonemap, sRGB encoding and quantization of [x0, x1) x [y0, y1) into pixels
+    void resolve(int x0, int y0, int x1, int y1, Tonemap tonemap, float exposure = 1.0f);
+
+    const Uint32* data() const { return pixels.data(); }
+    int pitch() const { return width * static_cast<int>(sizeof(Uint32)); }
+
+    // Binary PPM (P6), alpha is dropped
+    bool writePPM(const std::string& path) const;
+    bool writePNG(const std::string& path) const;
+
+    int width;
+    int height;
+
+private:
+    void resolveRow(int first, int last, Tonemap tonemap, float exposure);
+
+    std::vector<Radiance> radiance;
+    std::vector<Uint32> pixels;
+};
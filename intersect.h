@@ -9,4 +9,6 @@ struct Intersect {
     glm::vec3 normal;
     float u = 0.0f;
     float v = 0.0f;
+    // UV units per world unit across the surface; 0 where u and v aren't set
+    float uvScale = 0.0f;
 };
\ No newline at end of file
@@ -3,8 +3,23 @@
 #include "glm/glm.hpp"
 #include "color.h"
 
+enum class LightType {
+    Point,
+    // One-sided rectangle position + s * edgeU + t * edgeV, s and t in [0, 1], lit
+    // towards cross(edgeU, edgeV)
+    Area,
+    // Emissive unit block whose min corner is position, lit from every face
+    Block
+};
+
+// The global key light is a point light without distance falloff. Lights in a
+// LightTree fall off with the square of the distance; for area and block lights
+// intensity is per unit of emitting area seen head-on.
 struct Light {
     glm::vec3 position;
     float intensity;
     Color color;
-};
\ No newline at end of file
+    LightType type = LightType::Point;
+    glm::vec3 edgeU = glm::vec3(0.0f);
+    glm::vec3 edgeV = glm::vec3(0.0f);
+};
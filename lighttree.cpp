@@ -0,0 +1,169 @@
+#include "lighttree.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Squared distances below this are clamped, so surfaces touching a light don't blow up
+    const float MIN_DISTANCE_SQUARED = 0.25f;
+
+    AABB lightBounds(const Light& light) {
+        AABB bounds;
+        bounds.expand(light.position);
+        if (light.type == LightType::Area) {
+            bounds.expand(light.position + light.edgeU);
+            bounds.expand(light.position + light.edgeV);
+            bounds.expand(light.position + light.edgeU + light.edgeV);
+        } else if (light.type == LightType::Block) {
+            bounds.expand(light.position + glm::vec3(1.0f));
+        }
+        return bounds;
+    }
+
+    float lightPower(const Light& light) {
+        float power = light.intensity * (light.color.r + light.color.g + light.color.b) / 765.0f;
+        if (light.type == LightType::Area) {
+            power *= glm::length(glm::cross(light.edgeU, light.edgeV));
+        } else if (light.type == LightType::Block) {
+            // Up to three faces face any point
+            power *= 3.0f;
+        }
+        return power;
+    }
+
+    // Sets direction and distance to target, and the light arriving from it before the emitter's cosine
+    void arriving(const Light& light, const glm::vec3& point, const glm::vec3& target, LightSample& sample) {
+        glm::vec3 offset = target - point;
+        float distanceSquared = glm::dot(offset, offset);
+        sample.distance = std::sqrt(distanceSquared);
+        sample.direction = offset / sample.distance;
+        sample.radiance = toRadiance(light.color) * (light.intensity / std::max(distanceSquared, MIN_DISTANCE_SQUARED));
+    }
+}
+
+bool sampleLight(const Light& light, const glm::vec3& point, float u, float v, LightSample& sample) {
+    if (light.type == LightType::Point) {
+        arriving(light, point, light.position, sample);
+        return sample.distance > 0.0f;
+    }
+
+    if (light.type == LightType::Area) {
+        glm::vec3 normal = glm::normalize(glm::cross(light.edgeU, light.edgeV));
+        arriving(light, point, light.position + u * light.edgeU + v * light.edgeV, sample);
+        float cosine = -glm::dot(normal, sample.direction);
+        if (cosine <= 0.0f) {
+            return false;
+        }
+        // The rectangle's area cancels against the density of a uniform point on it
+        sample.radiance *= cosine * glm::length(glm::cross(light.edgeU, light.edgeV));
+        return true;
+    }
+
+    // Block: a uniform point on one of the faces turned towards the point
+    int faces[3];
+    int faceCount = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (point[axis] < light.position[axis] || point[axis] > light.position[axis] + 1.0f) {
+            faces[faceCount++] = axis;
+        }
+    }
+    if (faceCount == 0) {
+        return false;
+    }
+    int face = std::min(static_cast<int>(u * faceCount), faceCount - 1);
+    u = u * faceCount - face;
+    int axis = faces[face];
+    glm::vec3 target = light.position;
+    target[axis] += point[axis] > light.position[axis] ? 1.0f : 0.0f;
+    target[(axis + 1) % 3] += u;
+    target[(axis + 2) % 3] += v;
+    arriving(light, point, target, sample);
+    // Each face has unit area and is picked with probability 1 / faceCount
+    sample.radiance *= std::abs(sample.direction[axis]) * faceCount;
+    return true;
+}
+
+void LightTree::build(const std::vector<Light>& sceneLights) {
+    lights = sceneLights;
+    nodes.clear();
+    if (lights.empty()) {
+        return;
+    }
+    nodes.reserve(2 * lights.size() - 1);
+    nodes.push_back(Node());
+    subdivide(0, 0, size());
+}
+
+void LightTree::subdivide(int nodeIndex, int first, int count) {
+    AABB bounds;
+    AABB centroids;
+    float power = 0.0f;
+    for (int i = first; i < first + count; i++) {
+        AABB light = lightBounds(lights[i]);
+        bounds.expand(light);
+        centroids.expand(light.center());
+        power += lightPower(lights[i]);
+    }
+    nodes[nodeIndex].bounds = bounds;
+    nodes[nodeIndex].power = power;
+
+    if (count == 1) {
+        nodes[nodeIndex].leftFirst = first;
+        nodes[nodeIndex].leaf = true;
+        return;
+    }
+
+    // Median split along the longest axis of the light centers
+    glm::vec3 extent = centroids.max - centroids.min;
+    int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+    int half = count / 2;
+    std::nth_element(lights.begin() + first, lights.begin() + first + half, lights.begin() + first + count,
+                     [axis](const Light& a, const Light& b) {
+                         return lightBounds(a).center()[axis] < lightBounds(b).center()[axis];
+                     });
+
+    int left = static_cast<int>(nodes.size());
+    nodes[nodeIndex].leftFirst = left;
+    nodes[nodeIndex].leaf = false;
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    subdivide(left, first, half);
+    subdivide(left + 1, first + half, count - half);
+}
+
+// Power over the squared distance to the center of the node's bounds. Close to a big
+// node the lights could be anywhere, so the distance is clamped to half its diagonal.
+float LightTree::importance(const Node& node, const glm::vec3& point) const {
+    glm::vec3 offset = node.bounds.center() - point;
+    glm::vec3 diagonal = node.bounds.max - node.bounds.min;
+    float distanceSquared = std::max(glm::dot(offset, offset), 0.25f * glm::dot(diagonal, diagonal));
+    return node.power / std::max(distanceSquared, MIN_DISTANCE_SQUARED);
+}
+
+int LightTree::pick(const glm::vec3& point, float u, float& probability) const {
+    probability = 1.0f;
+    if (nodes.empty()) {
+        return -1;
+    }
+    const Node* node = &nodes[0];
+    while (!node->leaf) {
+        const Node& left = nodes[node->leftFirst];
+        const Node& right = nodes[node->leftFirst + 1];
+        float leftImportance = importance(left, point);
+        float total = leftImportance + importance(right, point);
+        if (total <= 0.0f) {
+            return -1;
+        }
+        // u is stretched back to [0, 1) after each choice
+        float leftShare = leftImportance / total;
+        if (u < leftShare) {
+            u /= leftShare;
+            probability *= leftShare;
+            node = &left;
+        } else {
+            u = std::min((u - leftShare) / (1.0f - leftShare), 0.99999994f);
+            probability *= 1.0f - leftShare;
+            node = &right;
+        }
+    }
+    return node->leftFirst;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "light.h"
+#include "radiance.h"
+
+// A point on a light as seen from a shading point
+struct LightSample {
+    // Unit vector from the shading point to the sampled point
+    glm::vec3 direction;
+    float distance;
+    // Light arriving along direction, before the receiving surface's cosine
+    Radiance radiance;
+};
+
+// Samples a point on light for a shading point from two numbers in [0, 1). False when
+// the light can't reach the point, such as from behind an area light.
+bool sampleLight(const Light& light, const glm::vec3& point, float u, float v, LightSample& sample);
+
+// Binary tree over many lights for picking one light per shading point with a
+// probability close to its share of the light there. Each node keeps the bounds and
+// total power of its lights; picking walks down from the root and chooses a child by
+// power over squared distance, so the cost grows with the log of the light count.
+class LightTree {
+public:
+    void build(const std::vector<Light>& sceneLights);
+
+    bool empty() const { return lights.empty(); }
+    int size() const { return static_cast<int>(lights.size()); }
+    const Light& getLight(int index) const { return lights[index]; }
+    size_t memoryFootprint() const { return lights.capacity() * sizeof(Light) + nodes.capacity() * sizeof(Node); }
+
+    // Index of a light for the shading point, chosen with u in [0, 1), and the
+    // probability it had of being chosen; -1 when no light is picked
+    int pick(const glm::vec3& point, float u, float& probability) const;
+
+private:
+    struct Node {
+        AABB bounds;
+        float power;
+        // Interior: children at leftFirst and leftFirst + 1. Leaf: the light at leftFirst.
+        int leftFirst;
+        bool leaf;
+    };
+
+    void subdivide(int nodeIndex, int first, int count);
+    float importance(const Node& node, const glm::vec3& point) const;
+
+    // In leaf order
+    std::vector<Light> lights;
+    std::vector<Node> nodes;
+};
@@ -0,0 +1,104 @@
+#include "mappedfile.h"
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+size_t MappedFile::pageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        throw std::runtime_error("Unable to open " + path);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle != nullptr) {
+        bytes = static_cast<const Uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (bytes == nullptr) {
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Unable to map " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(bytes);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+}
+
+void MappedFile::willNeed(size_t offset, size_t count) const {
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<Uint8*>(bytes + offset), count};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Unable to open " + path);
+    }
+    struct stat status;
+    fstat(descriptor, &status);
+    length = static_cast<size_t>(status.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close(descriptor);
+        throw std::runtime_error("Unable to map " + path);
+    }
+    bytes = static_cast<const Uint8*>(mapping);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<Uint8*>(bytes), length);
+    close(descriptor);
+}
+
+void MappedFile::willNeed(size_t offset, size_t count) const {
+    size_t page = pageSize();
+    size_t first = offset / page * page;
+    madvise(const_cast<Uint8*>(bytes + first), offset + count - first, MADV_WILLNEED);
+}
+
+#endif
+
+void MappedFile::release(size_t offset, size_t count) const {
+    // Pages shared with a neighbouring range stay
+    size_t page = pageSize();
+    size_t first = (offset + page - 1) / page * page;
+    size_t last = (offset + count) / page * page;
+    if (first >= last) {
+        return;
+    }
+#ifdef _WIN32
+    // Takes the pages out of the working set; they are read back from the file on access
+    VirtualUnlock(const_cast<Uint8*>(bytes + first), last - first);
+#else
+    madvise(const_cast<Uint8*>(bytes + first), last - first, MADV_DONTNEED);
+#endif
+}
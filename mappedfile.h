@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <SDL.h>
+
+// Read-only view of a whole file. Nothing is read up front: the OS pages the file in
+// as it is touched. release() lets it drop a range from memory again; the range is
+// read back from the file when next touched, so other threads may keep reading it.
+class MappedFile {
+public:
+    // Throws std::runtime_error when the file can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const Uint8* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Granularity of release(): the page size, or the allocation granularity on Windows
+    static size_t pageSize();
+
+    // Hint that [offset, offset + count) will be read soon
+    void willNeed(size_t offset, size_t count) const;
+    // Drops the whole pages inside [offset, offset + count) from memory
+    void release(size_t offset, size_t count) const;
+
+private:
+    const Uint8* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "color.h"
+#include "texture.h"
 
 struct Material {
     Color diffuse;
@@ -10,5 +11,12 @@ struct Material {
     float reflectivity; // The reflectivity of the material
     float transparency; // The transparency of the material
     float refractionIndex;
-    SDL_Surface* texture;
-};
\ No newline at end of file
+    const Texture* texture;
+};
+
+inline bool operator==(const Material& a, const Material& b) {
+    return a.diffuse.r == b.diffuse.r && a.diffuse.g == b.diffuse.g && a.diffuse.b == b.diffuse.b && a.diffuse.a == b.diffuse.a &&
+           a.albedo == b.albedo && a.specularAlbedo == b.specularAlbedo && a.specularCoefficient == b.specularCoefficient &&
+           a.reflectivity == b.reflectivity && a.transparency == b.transparency && a.refractionIndex == b.refractionIndex &&
+           a.texture == b.texture;
+}
@@ -4,30 +4,46 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "material.h"
 #include "intersect.h"
+#include "aabb.h"
 #include <SDL.h>
 
 class Object {
 public:
-    Object(const Material& mat) : material(mat), position(glm::vec3(0.0f)), rotationAxis(glm::vec3(0.0f, 1.0f, 0.0f)), rotationAngle(0.0f), scale(glm::vec3(1.0f)), texture(nullptr) {}
+    Object(const Material& mat) : material(mat), position(glm::vec3(0.0f)), rotationAxis(glm::vec3(0.0f, 1.0f, 0.0f)), rotationAngle(0.0f), scale(glm::vec3(1.0f)), texture(nullptr) {
+        updateTransform();
+    }
+    virtual ~Object() = default;
 
     virtual Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const = 0;
 
+    virtual AABB getBounds() const = 0;
+
     // Funciones para transformaciones
-    void translate(const glm::vec3& translation) { position += translation; }
+    void translate(const glm::vec3& translation) {
+        position += translation;
+        updateTransform();
+    }
     void rotate(float angle, const glm::vec3& axis) {
         rotationAngle += angle;
         rotationAxis = glm::normalize(rotationAxis + axis);
+        updateTransform();
     }
-    void scaleObject(const glm::vec3& scaleFactor) { scale *= scaleFactor; }
-
-    // Función para obtener la matriz de transformación del objeto
-    glm::mat4 getTransformMatrix() const {
-        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), position);
-        glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), rotationAngle, rotationAxis);
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
-        return translationMatrix * rotationMatrix * scaleMatrix;
+    void scaleObject(const glm::vec3& scaleFactor) {
+        scale *= scaleFactor;
+        updateTransform();
     }
 
+    // Matrices cacheadas; solo se recalculan cuando cambia la transformación
+    const glm::mat4& getTransformMatrix() const { return transformMatrix; }
+    const glm::mat4& getInverseTransformMatrix() const { return inverseTransformMatrix; }
+    const glm::mat3& getNormalMatrix() const { return normalMatrix; }
+    bool hasIdentityTransform() const { return identityTransform; }
+
+    const glm::vec3& getPosition() const { return position; }
+    const glm::vec3& getRotationAxis() const { return rotationAxis; }
+    float getRotationAngle() const { return rotationAngle; }
+    const glm::vec3& getScale() const { return scale; }
+
     void setTexture(SDL_Texture* tex) {
         texture = tex;
     }
@@ -36,12 +52,28 @@ public:
         return texture;
     }
 
+    Material material;
+
+private:
+    void updateTransform() {
+        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), position);
+        glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), rotationAngle, rotationAxis);
+        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
+        transformMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+        inverseTransformMatrix = glm::inverse(transformMatrix);
+        normalMatrix = glm::mat3(glm::transpose(inverseTransformMatrix));
+        identityTransform = transformMatrix == glm::mat4(1.0f);
+    }
+
     glm::vec3 position;
     glm::vec3 rotationAxis;
     float rotationAngle;
     glm::vec3 scale;
-    Material material;
 
-private:
+    glm::mat4 transformMatrix;
+    glm::mat4 inverseTransformMatrix;
+    glm::mat3 normalMatrix;
+    bool identityTransform;
+
     SDL_Texture* texture;
 };
\ No newline at end of file
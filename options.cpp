@@ -0,0 +1,282 @@
+#include "options.h"
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <iomanip>
+#include "renderer.h"
+#include "scenes.h"
+
+namespace {
+    std::string nextValue(int argc, char* argv[], int& i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(flag + " needs a value");
+        }
+        return argv[++i];
+    }
+
+    float parseFloat(const std::string& flag, const std::string& value) {
+        size_t used = 0;
+        float result = 0.0f;
+        try {
+            result = std::stof(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used != value.size()) {
+            throw std::invalid_argument(flag + ": expected a number, got '" + value + "'");
+        }
+        return result;
+    }
+
+    // "x,y,z"
+    glm::vec3 parseVec3(const std::string& flag, const std::string& value) {
+        std::stringstream stream(value);
+        std::string component;
+        glm::vec3 result;
+        int count = 0;
+        while (std::getline(stream, component, ',')) {
+            if (count == 3) {
+                count++;
+                break;
+            }
+            result[count++] = parseFloat(flag, component);
+        }
+        if (count != 3) {
+            throw std::invalid_argument(flag + ": expected x,y,z, got '" + value + "'");
+        }
+        return result;
+    }
+
+    // "800x600"
+    void parseResolution(const std::string& flag, const std::string& value, int& width, int& height) {
+        size_t separator = value.find('x');
+        if (separator == std::string::npos) {
+            throw std::invalid_argument(flag + ": expected WIDTHxHEIGHT, got '" + value + "'");
+        }
+        width = parseInt(flag, value.substr(0, separator), 1);
+        height = parseInt(flag, value.substr(separator + 1), 1);
+    }
+
+    bool endsWith(const std::string& text, const std::string& suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+int parseInt(const std::string& flag, const std::string& value, int minimum) {
+    size_t used = 0;
+    int result = 0;
+    try {
+        result = std::stoi(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != value.size() || result < minimum) {
+        throw std::invalid_argument(flag + ": expected an integer >= " + std::to_string(minimum) + ", got '" + value + "'");
+    }
+    return result;
+}
+
+RenderOptions parseOptions(int argc, char* argv[]) {
+    RenderOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "--help" || flag == "-h") {
+            options.mode = "help";
+        } else if (flag == "--headless") {
+            options.mode = "headless";
+        } else if (flag == "--output" || flag == "-o" || flag == "--dump") {
+            options.mode = "headless";
+            options.output = nextValue(argc, argv, i);
+        } else if (flag == "--resolution") {
+            parseResolution(flag, nextValue(argc, argv, i), options.width, options.height);
+        } else if (flag == "--fov") {
+            options.fov = glm::radians(parseFloat(flag, nextValue(argc, argv, i)));
+        } else if (flag == "--camera") {
+            options.cameraPosition = parseVec3(flag, nextValue(argc, argv, i));
+        } else if (flag == "--target") {
+            options.cameraTarget = parseVec3(flag, nextValue(argc, argv, i));
+        } else if (flag == "--orbit") {
+            options.orbit = parseFloat(flag, nextValue(argc, argv, i));
+        } else if (flag == "--samples") {
+            options.samples = parseInt(flag, nextValue(argc, argv, i), 1);
+        } else if (flag == "--max-depth") {
+            options.maxDepth = parseInt(flag, nextValue(argc, argv, i), 0);
+            if (options.maxDepth > MAX_DEPTH_LIMIT) {
+                throw std::invalid_argument("--max-depth: at most " + std::to_string(MAX_DEPTH_LIMIT));
+            }
+        } else if (flag == "--no-ray-culling") {
+            options.rayCulling = false;
+        } else if (flag == "--wavefront") {
+            options.wavefront = true;
+        } else if (flag == "--no-occluder-cache") {
+            options.occluderCache = false;
+        } else if (flag == "--light-samples") {
+            options.lightSamples = parseInt(flag, nextValue(argc, argv, i), 0);
+        } else if (flag == "--no-progressive") {
+            options.progressive = false;
+        } else if (flag == "--max-samples") {
+            options.maxSamples = parseInt(flag, nextValue(argc, argv, i), 1);
+        } else if (flag == "--reprojection") {
+            options.reprojection = true;
+        } else if (flag == "--adaptive") {
+            options.adaptiveSamples = parseInt(flag, nextValue(argc, argv, i), 2);
+        } else if (flag == "--adaptive-threshold") {
+            std::string value = nextValue(argc, argv, i);
+            options.adaptiveThreshold = parseFloat(flag, value);
+            if (!(options.adaptiveThreshold >= 0.0f)) {
+                throw std::invalid_argument(flag + ": expected a number >= 0, got '" + value + "'");
+            }
+        } else if (flag == "--threads") {
+            options.threads = parseInt(flag, nextValue(argc, argv, i), 0);
+        } else if (flag == "--frames") {
+            options.frames = parseInt(flag, nextValue(argc, argv, i), 1);
+        } else if (flag == "--assets") {
+            options.assetDirectory = nextValue(argc, argv, i);
+        } else if (flag == "--voxel") {
+            options.voxel = true;
+        } else if (flag == "--world") {
+            options.worldFile = nextValue(argc, argv, i);
+        } else if (flag == "--world-budget") {
+            options.worldBudgetMB = parseInt(flag, nextValue(argc, argv, i), 1);
+        } else if (flag == "--bilinear") {
+            options.bilinear = true;
+        } else if (flag == "--no-mipmaps") {
+            options.mipmaps = false;
+        } else if (flag == "--tonemap") {
+            options.tonemap = nextValue(argc, argv, i);
+            if (options.tonemap != "clamp" && options.tonemap != "reinhard" && options.tonemap != "aces") {
+                throw std::invalid_argument("--tonemap: expected clamp, reinhard or aces, got '" + options.tonemap + "'");
+            }
+        } else if (flag == "--exposure") {
+            options.exposure = parseFloat(flag, nextValue(argc, argv, i));
+        } else if (flag == "--packets") {
+            options.packets = nextValue(argc, argv, i);
+            if (options.packets != "auto" && options.packets != "off" && options.packets != "scalar" &&
+                options.packets != "sse" && options.packets != "avx2") {
+                throw std::invalid_argument("--packets: expected auto, off, scalar, sse or avx2, got '" + options.packets + "'");
+            }
+        } else if (flag.rfind("--bench-", 0) == 0) {
+            options.mode = flag.substr(2);
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                options.modeArgument = parseInt(flag, argv[++i], 1);
+            }
+        } else {
+            throw std::invalid_argument("unknown option '" + flag + "'");
+        }
+    }
+
+    if (options.reprojection && options.mode == "window" && options.progressive) {
+        throw std::invalid_argument("--reprojection: the window's progressive passes don't reuse frames, add --no-progressive");
+    }
+    if (options.reprojection && options.samples > 1) {
+        throw std::invalid_argument("--reprojection: traces one sample per pixel, can't be combined with --samples");
+    }
+    if (options.adaptiveSamples > 0 && (options.samples > 1 || options.reprojection)) {
+        throw std::invalid_argument("--adaptive: picks the samples of each pixel, can't be combined with --samples or --reprojection");
+    }
+    if (!options.worldFile.empty() && options.voxel) {
+        throw std::invalid_argument("--world: streams a terrain in place of the diorama, can't be combined with --voxel");
+    }
+    if (!options.output.empty() && !endsWith(options.output, ".ppm") && !endsWith(options.output, ".png")) {
+        throw std::invalid_argument("--output: only .ppm and .png are supported, got '" + options.output + "'");
+    }
+    return options;
+}
+
+void applyCameraOptions(const RenderOptions& options) {
+    if (options.cameraPosition) {
+        camera.position = *options.cameraPosition;
+    }
+    if (options.cameraTarget) {
+        camera.target = *options.cameraTarget;
+    }
+}
+
+void applyRenderOptions(const RenderOptions& options) {
+    screenWidth = options.width;
+    screenHeight = options.height;
+    framebuffer = Framebuffer(screenWidth, screenHeight);
+    fieldOfView = options.fov;
+    samplesPerPixel = options.samples;
+    if (options.threads > 0) {
+        threadCount = options.threads;
+    }
+    assetDirectory = options.assetDirectory;
+    useVoxelWorld = options.voxel;
+    worldFile = options.worldFile;
+    worldBudget = static_cast<size_t>(options.worldBudgetMB) << 20;
+    bilinearTextures = options.bilinear;
+    mipmapping = options.mipmaps;
+    maxDepth = options.maxDepth;
+    rayCulling = options.rayCulling;
+    wavefront = options.wavefront;
+    occluderCache = options.occluderCache;
+    lightSamples = options.lightSamples;
+    tonemap = options.tonemap == "reinhard" ? Tonemap::Reinhard : options.tonemap == "aces" ? Tonemap::Aces : Tonemap::Clamp;
+    exposure = std::exp2(options.exposure);
+    applyCameraOptions(options);
+    if (options.packets != "auto") {
+        packetKernels = options.packets == "off" ? nullptr
+                      : options.packets == "scalar" ? scalarPacketKernels()
+                      : options.packets == "sse" ? ssePacketKernels()
+                      : avx2PacketKernels();
+        if (packetKernels == nullptr && options.packets != "off") {
+            std::cerr << "Packet kernels '" << options.packets << "' not supported here, tracing rays one by one" << std::endl;
+        }
+    }
+}
+
+void printUsage(std::ostream& out) {
+    out << "Usage: Raytracing [options]\n"
+           "  --headless               render without opening a window\n"
+           "  -o, --output FILE        write frames to FILE (.ppm or .png); implies --headless\n"
+           "  --frames N               frames to render headless (default 1)\n"
+           "  --orbit DEGREES          orbit the camera around its target between frames\n"
+           "  --resolution WxH         image size (default 800x600)\n"
+           "  --fov DEGREES            vertical field of view (default 60)\n"
+           "  --camera X,Y,Z           camera position\n"
+           "  --target X,Y,Z           point the camera looks at\n"
+           "  --samples N              samples per pixel (default 1)\n"
+           "  --max-depth N            bounces of reflected and refracted rays (default 1)\n"
+           "  --no-ray-culling         trace reflected and refracted rays however little they add\n"
+           "  --wavefront              trace whole frames stage by stage in sorted ray batches\n"
+           "  --no-occluder-cache      don't test a shadow ray's last occluder first\n"
+           "  --light-samples N        scene lights sampled per hit, 0 for every light (default 1)\n"
+           "  --no-progressive         window: render whole frames instead of refining passes\n"
+           "  --max-samples N          window: samples a still view accumulates (default 64)\n"
+           "  --reprojection           reuse diffuse shading of the previous frame after camera moves;\n"
+           "                           in the window, needs --no-progressive. Pays off where primary\n"
+           "                           hits are costly (large voxel worlds); slower than a full render\n"
+           "                           on scenes of mostly reflective materials, like the diorama\n"
+           "  --adaptive N             headless: up to N samples on edges, one elsewhere\n"
+           "  --adaptive-threshold T   color difference that counts as an edge (default 0.1)\n"
+           "  --threads N              render threads, 0 for all cores (default 0)\n"
+           "  --assets DIR             texture directory (default ../assets)\n"
+           "  --voxel                  store grid-aligned blocks in a voxel grid\n"
+           "  --world FILE             stream the terrain in a chunk file written by --bench-streaming\n"
+           "  --world-budget MB        memory the streamed terrain may keep resident (default 64)\n"
+           "  --bilinear               bilinear texture filtering\n"
+           "  --no-mipmaps             always sample full-resolution textures\n"
+           "  --tonemap OPERATOR       clamp, reinhard or aces (default clamp)\n"
+           "  --exposure STOPS         scale radiance by 2^STOPS before the tonemap (default 0)\n"
+           "  --packets MODE           auto, off, scalar, sse or avx2 (default auto)\n"
+           "Benchmarks, run through RaytracingBenchmark with the options above:\n"
+           "  --bench-threads [frames], --bench-bvh, --bench-layout, --bench-voxel [size],\n"
+           "  --bench-slab, --bench-packets [frames], --bench-textures [frames],\n"
+           "  --bench-skybox [frames], --bench-progressive, --bench-reprojection [frames],\n"
+           "  --bench-relight [frames], --bench-depth [frames], --bench-wavefront [frames],\n"
+           "  --bench-shadows [frames], --bench-lights [frames], --bench-adaptive [frames],\n"
+           "  --bench-bricks [max size], --bench-streaming [size]\n";
+}
+
+std::string frameOutputPath(const std::string& output, int frame, int frameCount) {
+    if (frameCount <= 1) {
+        return output;
+    }
+    size_t extension = output.rfind('.');
+    std::ostringstream path;
+    path << output.substr(0, extension) << "_" << std::setw(4) << std::setfill('0') << frame << output.substr(extension);
+    return path.str();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include "glm/glm.hpp"
+
+// Command-line settings. Anything not given keeps the value the interactive
+// window has always used.
+struct RenderOptions {
+    // "window", "headless", or a benchmark name such as "bench-threads"
+    std::string mode = "window";
+    // Optional numeric argument of a benchmark (frames, world size)
+    std::optional<int> modeArgument;
+
+    int width = 800;
+    int height = 600;
+    // Vertical field of view in radians
+    float fov = 3.1415 / 3;
+    std::optional<glm::vec3> cameraPosition;
+    std::optional<glm::vec3> cameraTarget;
+    // Degrees the camera orbits its target between headless frames
+    float orbit = 0.0f;
+
+    int samples = 1;
+    // Bounces before reflected and refracted rays see the sky
+    int maxDepth = 1;
+    // Drop negligible reflected and refracted rays (weight cutoff and Russian roulette)
+    bool rayCulling = true;
+    // Whole frames go through the wavefront stages instead of per-pixel tracing
+    bool wavefront = false;
+    // Shadow rays try the last occluder of their thread before the BVH and the voxel grid
+    bool occluderCache = true;
+    // Lights sampled per shading point from the light tree; 0 takes every light
+    int lightSamples = 1;
+    // Window only: refine in passes instead of blocking on whole frames
+    bool progressive = true;
+    // Samples per pixel a still progressive view accumulates
+    int maxSamples = 64;
+    // Reuse the previous frame's diffuse shading after camera moves (headless, or window without progressive)
+    bool reprojection = false;
+    // Headless: most samples an edge pixel gets, one sample elsewhere; 0 samples every pixel alike
+    int adaptiveSamples = 0;
+    // Neighbouring colors further apart than this in any channel make an edge
+    float adaptiveThreshold = 0.1f;
+    // 0 uses every hardware thread
+    unsigned int threads = 0;
+    int frames = 1;
+    // Headless output; .png or .ppm. With several frames the frame number goes before the extension.
+    std::string output;
+    std::string assetDirectory = "../assets";
+
+    bool voxel = false;
+    // Chunk file of a terrain to stream instead of the diorama, and the MB of it kept in memory
+    std::string worldFile;
+    int worldBudgetMB = 64;
+    bool bilinear = false;
+    bool mipmaps = true;
+    // "clamp", "reinhard" or "aces"
+    std::string tonemap = "clamp";
+    // Stops above or below the scene's radiance
+    float exposure = 0.0f;
+    // "auto", "off", "scalar", "sse" or "avx2"
+    std::string packets = "auto";
+};
+
+// Throws std::invalid_argument describing the first bad argument
+RenderOptions parseOptions(int argc, char* argv[]);
+
+// Throws std::invalid_argument unless value is an integer >= minimum
+int parseInt(const std::string& flag, const std::string& value, int minimum);
+
+// Copies the settings into the renderer's and the scenes' globals
+void applyRenderOptions(const RenderOptions& options);
+// Sets the camera given by --camera and --target; scenes that place their own camera
+// (loadScene() with a world file) need it again after loading
+void applyCameraOptions(const RenderOptions& options);
+
+void printUsage(std::ostream& out);
+
+// output with the frame number inserted before the extension: frame_0003.png
+std::string frameOutputPath(const std::string& output, int frame, int frameCount);
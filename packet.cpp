@@ -0,0 +1,171 @@
+#include "packet.h"
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Defined in packet_sse.cpp and packet_avx2.cpp, which are compiled with their own
+// instruction-set flags; nullptr when the build target doesn't support them.
+const PacketKernels* ssePacketKernelTable();
+const PacketKernels* avx2PacketKernelTable();
+
+void RayPacket::setRay(int lane, const glm::vec3& origin, const glm::vec3& direction, int ignore) {
+    originX[lane] = origin.x;
+    originY[lane] = origin.y;
+    originZ[lane] = origin.z;
+    directionX[lane] = direction.x;
+    directionY[lane] = direction.y;
+    directionZ[lane] = direction.z;
+    invDirectionX[lane] = 1.0f / direction.x;
+    invDirectionY[lane] = 1.0f / direction.y;
+    invDirectionZ[lane] = 1.0f / direction.z;
+    tMax[lane] = 99999;
+    primitive[lane] = -1;
+    ignorePrimitive[lane] = ignore;
+    activeMask |= 1u << lane;
+}
+
+namespace {
+    const int SCALAR_WIDTH = 4;
+
+    unsigned int scalarIntersectBounds(const RayPacket& packet, unsigned int laneMask, const float* bounds) {
+        unsigned int hitMask = 0;
+        for (int lane = 0; lane < SCALAR_WIDTH; lane++) {
+            if (!(laneMask & (1u << lane))) {
+                continue;
+            }
+            float t1x = (bounds[0] - packet.originX[lane]) * packet.invDirectionX[lane];
+            float t2x = (bounds[3] - packet.originX[lane]) * packet.invDirectionX[lane];
+            float t1y = (bounds[1] - packet.originY[lane]) * packet.invDirectionY[lane];
+            float t2y = (bounds[4] - packet.originY[lane]) * packet.invDirectionY[lane];
+            float t1z = (bounds[2] - packet.originZ[lane]) * packet.invDirectionZ[lane];
+            float t2z = (bounds[5] - packet.originZ[lane]) * packet.invDirectionZ[lane];
+            float tNear = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), std::min(t1z, t2z));
+            float tFar = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), std::max(t1z, t2z));
+            if (tNear <= tFar && tFar >= 0.0f && tNear < packet.tMax[lane]) {
+                hitMask |= 1u << lane;
+            }
+        }
+        return hitMask;
+    }
+
+    unsigned int scalarIntersectBoxes(RayPacket& packet, unsigned int laneMask, const BoxArrays& boxes,
+                                      int start, int count, int idOffset, bool anyHit) {
+        unsigned int hitMask = 0;
+        for (int box = start; box < start + count && laneMask != 0; box++) {
+            float bounds[6] = {boxes.minX[box], boxes.minY[box], boxes.minZ[box], boxes.maxX[box], boxes.maxY[box], boxes.maxZ[box]};
+            for (int lane = 0; lane < SCALAR_WIDTH; lane++) {
+                if (!(laneMask & (1u << lane))) {
+                    continue;
+                }
+                float t1x = (bounds[0] - packet.originX[lane]) * packet.invDirectionX[lane];
+                float t2x = (bounds[3] - packet.originX[lane]) * packet.invDirectionX[lane];
+                float t1y = (bounds[1] - packet.originY[lane]) * packet.invDirectionY[lane];
+                float t2y = (bounds[4] - packet.originY[lane]) * packet.invDirectionY[lane];
+                float t1z = (bounds[2] - packet.originZ[lane]) * packet.invDirectionZ[lane];
+                float t2z = (bounds[5] - packet.originZ[lane]) * packet.invDirectionZ[lane];
+                float tNear = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), std::min(t1z, t2z));
+                float tFar = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), std::max(t1z, t2z));
+                if (tNear > tFar || tFar < 0.0f) {
+                    continue;
+                }
+
+                int id = idOffset + box;
+                bool accept = tNear < packet.tMax[lane] && (!anyHit || (tNear > 0.0f && id != packet.ignorePrimitive[lane]));
+                if (accept) {
+                    packet.tMax[lane] = tNear;
+                    packet.primitive[lane] = id;
+                    hitMask |= 1u << lane;
+                    if (anyHit) {
+                        laneMask &= ~(1u << lane);
+                    }
+                }
+            }
+        }
+        return hitMask;
+    }
+
+    unsigned int scalarIntersectSpheres(RayPacket& packet, unsigned int laneMask, const SphereArrays& spheres,
+                                        int start, int count, int idOffset, bool anyHit) {
+        unsigned int hitMask = 0;
+        for (int sphere = start; sphere < start + count && laneMask != 0; sphere++) {
+            for (int lane = 0; lane < SCALAR_WIDTH; lane++) {
+                if (!(laneMask & (1u << lane))) {
+                    continue;
+                }
+                float ocX = packet.originX[lane] - spheres.centerX[sphere];
+                float ocY = packet.originY[lane] - spheres.centerY[sphere];
+                float ocZ = packet.originZ[lane] - spheres.centerZ[sphere];
+                float dX = packet.directionX[lane];
+                float dY = packet.directionY[lane];
+                float dZ = packet.directionZ[lane];
+
+                float a = dX * dX + dY * dY + dZ * dZ;
+                float b = 2.0f * (ocX * dX + ocY * dY + ocZ * dZ);
+                float c = ocX * ocX + ocY * ocY + ocZ * ocZ - spheres.radius[sphere] * spheres.radius[sphere];
+                float discriminant = b * b - 4 * a * c;
+                if (discriminant < 0) {
+                    continue;
+                }
+                float dist = (-b - std::sqrt(discriminant)) / (2.0f * a);
+                if (dist < 0) {
+                    continue;
+                }
+
+                int id = idOffset + sphere;
+                bool accept = dist < packet.tMax[lane] && (!anyHit || (dist > 0.0f && id != packet.ignorePrimitive[lane]));
+                if (accept) {
+                    packet.tMax[lane] = dist;
+                    packet.primitive[lane] = id;
+                    hitMask |= 1u << lane;
+                    if (anyHit) {
+                        laneMask &= ~(1u << lane);
+                    }
+                }
+            }
+        }
+        return hitMask;
+    }
+
+    bool cpuSupportsAVX2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        bool fma = info[2] & (1 << 12);
+        __cpuidex(info, 7, 0);
+        bool avx2 = info[1] & (1 << 5);
+        return osSavesYmm && fma && avx2;
+#else
+        return false;
+#endif
+    }
+}
+
+const PacketKernels* scalarPacketKernels() {
+    static const PacketKernels kernels = {"scalar", SCALAR_WIDTH, scalarIntersectBounds, scalarIntersectBoxes, scalarIntersectSpheres};
+    return &kernels;
+}
+
+const PacketKernels* ssePacketKernels() {
+    return ssePacketKernelTable();
+}
+
+const PacketKernels* avx2PacketKernels() {
+    static const bool supported = cpuSupportsAVX2();
+    return supported ? avx2PacketKernelTable() : nullptr;
+}
+
+const PacketKernels* bestPacketKernels() {
+    if (const PacketKernels* kernels = avx2PacketKernels()) {
+        return kernels;
+    }
+    if (const PacketKernels* kernels = ssePacketKernels()) {
+        return kernels;
+    }
+    return scalarPacketKernels();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+// Structure-of-arrays bundle of coherent rays traced together. The lane count
+// in use is the width of the selected PacketKernels (4 for SSE and scalar, 8 for AVX2).
+struct RayPacket {
+    static const int MAX_WIDTH = 8;
+
+    alignas(32) float originX[MAX_WIDTH];
+    alignas(32) float originY[MAX_WIDTH];
+    alignas(32) float originZ[MAX_WIDTH];
+    alignas(32) float directionX[MAX_WIDTH];
+    alignas(32) float directionY[MAX_WIDTH];
+    alignas(32) float directionZ[MAX_WIDTH];
+    alignas(32) float invDirectionX[MAX_WIDTH];
+    alignas(32) float invDirectionY[MAX_WIDTH];
+    alignas(32) float invDirectionZ[MAX_WIDTH];
+
+    // Closest-hit: distance to the closest hit so far. Any-hit: the longest occluder
+    // distance that counts, such as the distance to the light, then the occluder's.
+    alignas(32) float tMax[MAX_WIDTH];
+    // Hit primitive per lane, -1 when nothing was hit
+    alignas(32) int primitive[MAX_WIDTH];
+    // Any-hit only: primitive each lane must not report (the surface it starts on)
+    alignas(32) int ignorePrimitive[MAX_WIDTH];
+
+    unsigned int activeMask = 0;
+
+    // Sets up lane `lane` and marks it active; tMax starts at the castRay zBuffer limit
+    void setRay(int lane, const glm::vec3& origin, const glm::vec3& direction, int ignore = -1);
+};
+
+// Flattened box and sphere arrays as stored by Scene
+struct BoxArrays {
+    const float* minX;
+    const float* minY;
+    const float* minZ;
+    const float* maxX;
+    const float* maxY;
+    const float* maxZ;
+};
+
+struct SphereArrays {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+};
+
+// One instruction-set specific implementation of the packet kernels. Every kernel
+// only touches lanes set in laneMask and returns a lane mask.
+struct PacketKernels {
+    const char* name;
+    int width;
+
+    // Lanes whose ray enters bounds (min xyz, max xyz) before their tMax
+    unsigned int (*intersectBounds)(const RayPacket& packet, unsigned int laneMask, const float* bounds);
+
+    // Closest-hit: lowers tMax and sets primitive for lanes that hit one of the
+    // boxes [start, start + count); returns the lanes that hit.
+    // Any-hit (anyHit = true): records the first box with an entry distance in (0, tMax)
+    // that isn't the lane's ignorePrimitive; returns the lanes that became occluded.
+    unsigned int (*intersectBoxes)(RayPacket& packet, unsigned int laneMask, const BoxArrays& boxes,
+                                   int start, int count, int idOffset, bool anyHit);
+    unsigned int (*intersectSpheres)(RayPacket& packet, unsigned int laneMask, const SphereArrays& spheres,
+                                     int start, int count, int idOffset, bool anyHit);
+};
+
+const PacketKernels* scalarPacketKernels();
+// nullptr when the build or the CPU doesn't support the instruction set
+const PacketKernels* ssePacketKernels();
+const PacketKernels* avx2PacketKernels();
+
+// Widest kernel set the running CPU supports
+const PacketKernels* bestPacketKernels();
@@ -0,0 +1,138 @@
+#include "packet.h"
+
+// Built with -mavx2 -mfma (/arch:AVX2 on MSVC) on x86 targets; nothing in here runs
+// unless avx2PacketKernels() confirmed CPU support. Only intrinsics are used, so no
+// inline function from a shared header gets an AVX2 copy that could leak into other files.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+    const int AVX2_WIDTH = 8;
+
+    inline __m256 laneMaskToVector(unsigned int laneMask) {
+        const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256i selected = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(laneMask)), bits);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(selected, bits));
+    }
+
+    inline __m256 select(__m256 mask, __m256 a, __m256 b) {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+
+    // Entry and exit distance of the eight rays into one box
+    inline void slab(const RayPacket& packet, float minX, float minY, float minZ, float maxX, float maxY, float maxZ,
+                     __m256& tNear, __m256& tFar) {
+        __m256 originX = _mm256_load_ps(packet.originX);
+        __m256 originY = _mm256_load_ps(packet.originY);
+        __m256 originZ = _mm256_load_ps(packet.originZ);
+        __m256 invX = _mm256_load_ps(packet.invDirectionX);
+        __m256 invY = _mm256_load_ps(packet.invDirectionY);
+        __m256 invZ = _mm256_load_ps(packet.invDirectionZ);
+
+        __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(minX), originX), invX);
+        __m256 t2x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(maxX), originX), invX);
+        __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(minY), originY), invY);
+        __m256 t2y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(maxY), originY), invY);
+        __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(minZ), originZ), invZ);
+        __m256 t2z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(maxZ), originZ), invZ);
+
+        tNear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t1x, t2x), _mm256_min_ps(t1y, t2y)), _mm256_min_ps(t1z, t2z));
+        tFar = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t1x, t2x), _mm256_max_ps(t1y, t2y)), _mm256_max_ps(t1z, t2z));
+    }
+
+    // Keeps dist for the accepted lanes and retires occluded lanes in any-hit mode
+    inline unsigned int record(RayPacket& packet, __m256 accept, __m256 dist, int id, unsigned int& laneMask, bool anyHit) {
+        unsigned int accepted = static_cast<unsigned int>(_mm256_movemask_ps(accept));
+        if (accepted == 0) {
+            return 0;
+        }
+        __m256 tMax = _mm256_load_ps(packet.tMax);
+        __m256i primitive = _mm256_load_si256(reinterpret_cast<const __m256i*>(packet.primitive));
+        __m256i acceptInt = _mm256_castps_si256(accept);
+        _mm256_store_ps(packet.tMax, select(accept, dist, tMax));
+        primitive = _mm256_blendv_epi8(primitive, _mm256_set1_epi32(id), acceptInt);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(packet.primitive), primitive);
+        if (anyHit) {
+            laneMask &= ~accepted;
+        }
+        return accepted;
+    }
+
+    inline __m256 acceptLanes(const RayPacket& packet, __m256 hit, __m256 dist, int id, bool anyHit) {
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(dist, _mm256_load_ps(packet.tMax), _CMP_LT_OQ));
+        if (anyHit) {
+            __m256i ignore = _mm256_load_si256(reinterpret_cast<const __m256i*>(packet.ignorePrimitive));
+            __m256 ignored = _mm256_castsi256_ps(_mm256_cmpeq_epi32(ignore, _mm256_set1_epi32(id)));
+            return _mm256_andnot_ps(ignored, _mm256_and_ps(hit, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GT_OQ)));
+        }
+        return hit;
+    }
+
+    unsigned int avx2IntersectBounds(const RayPacket& packet, unsigned int laneMask, const float* bounds) {
+        __m256 tNear, tFar;
+        slab(packet, bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5], tNear, tFar);
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ), _mm256_cmp_ps(tFar, _mm256_setzero_ps(), _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(tNear, _mm256_load_ps(packet.tMax), _CMP_LT_OQ));
+        return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(hit, laneMaskToVector(laneMask))));
+    }
+
+    unsigned int avx2IntersectBoxes(RayPacket& packet, unsigned int laneMask, const BoxArrays& boxes,
+                                   int start, int count, int idOffset, bool anyHit) {
+        unsigned int hitMask = 0;
+        for (int box = start; box < start + count && laneMask != 0; box++) {
+            __m256 tNear, tFar;
+            slab(packet, boxes.minX[box], boxes.minY[box], boxes.minZ[box], boxes.maxX[box], boxes.maxY[box], boxes.maxZ[box], tNear, tFar);
+            __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ), _mm256_cmp_ps(tFar, _mm256_setzero_ps(), _CMP_GE_OQ));
+            hit = _mm256_and_ps(hit, laneMaskToVector(laneMask));
+
+            int id = idOffset + box;
+            hitMask |= record(packet, acceptLanes(packet, hit, tNear, id, anyHit), tNear, id, laneMask, anyHit);
+        }
+        return hitMask;
+    }
+
+    unsigned int avx2IntersectSpheres(RayPacket& packet, unsigned int laneMask, const SphereArrays& spheres,
+                                     int start, int count, int idOffset, bool anyHit) {
+        __m256 dX = _mm256_load_ps(packet.directionX);
+        __m256 dY = _mm256_load_ps(packet.directionY);
+        __m256 dZ = _mm256_load_ps(packet.directionZ);
+        __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dX, dX), _mm256_mul_ps(dY, dY)), _mm256_mul_ps(dZ, dZ));
+        __m256 twoA = _mm256_mul_ps(_mm256_set1_ps(2.0f), a);
+
+        unsigned int hitMask = 0;
+        for (int sphere = start; sphere < start + count && laneMask != 0; sphere++) {
+            __m256 ocX = _mm256_sub_ps(_mm256_load_ps(packet.originX), _mm256_set1_ps(spheres.centerX[sphere]));
+            __m256 ocY = _mm256_sub_ps(_mm256_load_ps(packet.originY), _mm256_set1_ps(spheres.centerY[sphere]));
+            __m256 ocZ = _mm256_sub_ps(_mm256_load_ps(packet.originZ), _mm256_set1_ps(spheres.centerZ[sphere]));
+            __m256 radius = _mm256_set1_ps(spheres.radius[sphere]);
+
+            __m256 b = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, dX), _mm256_mul_ps(ocY, dY)), _mm256_mul_ps(ocZ, dZ)));
+            __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, ocX), _mm256_mul_ps(ocY, ocY)), _mm256_mul_ps(ocZ, ocZ)), _mm256_mul_ps(radius, radius));
+            __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(4.0f), a), c));
+            __m256 hit = _mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GE_OQ);
+
+            // Lanes that miss take the square root of zero instead of a negative number
+            __m256 root = _mm256_sqrt_ps(_mm256_and_ps(hit, discriminant));
+            __m256 dist = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), b), root), twoA);
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+            hit = _mm256_and_ps(hit, laneMaskToVector(laneMask));
+
+            int id = idOffset + sphere;
+            hitMask |= record(packet, acceptLanes(packet, hit, dist, id, anyHit), dist, id, laneMask, anyHit);
+        }
+        return hitMask;
+    }
+}
+
+const PacketKernels* avx2PacketKernelTable() {
+    static const PacketKernels kernels = {"avx2", AVX2_WIDTH, avx2IntersectBounds, avx2IntersectBoxes, avx2IntersectSpheres};
+    return &kernels;
+}
+
+#else
+
+const PacketKernels* avx2PacketKernelTable() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "packet.h"
+
+// SSE2 is part of the x86-64 baseline, so this file needs no extra compiler flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+namespace {
+    const int SSE_WIDTH = 4;
+
+    inline __m128 laneMaskToVector(unsigned int laneMask) {
+        const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+        __m128i selected = _mm_and_si128(_mm_set1_epi32(static_cast<int>(laneMask)), bits);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(selected, bits));
+    }
+
+    inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // Entry and exit distance of the four rays into one box
+    inline void slab(const RayPacket& packet, float minX, float minY, float minZ, float maxX, float maxY, float maxZ,
+                     __m128& tNear, __m128& tFar) {
+        __m128 originX = _mm_load_ps(packet.originX);
+        __m128 originY = _mm_load_ps(packet.originY);
+        __m128 originZ = _mm_load_ps(packet.originZ);
+        __m128 invX = _mm_load_ps(packet.invDirectionX);
+        __m128 invY = _mm_load_ps(packet.invDirectionY);
+        __m128 invZ = _mm_load_ps(packet.invDirectionZ);
+
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minX), originX), invX);
+        __m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxX), originX), invX);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minY), originY), invY);
+        __m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxY), originY), invY);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minZ), originZ), invZ);
+        __m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxZ), originZ), invZ);
+
+        tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_min_ps(t1z, t2z));
+        tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_max_ps(t1z, t2z));
+    }
+
+    // Keeps dist for the accepted lanes and retires occluded lanes in any-hit mode
+    inline unsigned int record(RayPacket& packet, __m128 accept, __m128 dist, int id, unsigned int& laneMask, bool anyHit) {
+        unsigned int accepted = static_cast<unsigned int>(_mm_movemask_ps(accept));
+        if (accepted == 0) {
+            return 0;
+        }
+        __m128 tMax = _mm_load_ps(packet.tMax);
+        __m128i primitive = _mm_load_si128(reinterpret_cast<const __m128i*>(packet.primitive));
+        __m128i acceptInt = _mm_castps_si128(accept);
+        _mm_store_ps(packet.tMax, select(accept, dist, tMax));
+        primitive = _mm_or_si128(_mm_and_si128(acceptInt, _mm_set1_epi32(id)), _mm_andnot_si128(acceptInt, primitive));
+        _mm_store_si128(reinterpret_cast<__m128i*>(packet.primitive), primitive);
+        if (anyHit) {
+            laneMask &= ~accepted;
+        }
+        return accepted;
+    }
+
+    inline __m128 acceptLanes(const RayPacket& packet, __m128 hit, __m128 dist, int id, bool anyHit) {
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(dist, _mm_load_ps(packet.tMax)));
+        if (anyHit) {
+            __m128i ignore = _mm_load_si128(reinterpret_cast<const __m128i*>(packet.ignorePrimitive));
+            __m128 ignored = _mm_castsi128_ps(_mm_cmpeq_epi32(ignore, _mm_set1_epi32(id)));
+            return _mm_andnot_ps(ignored, _mm_and_ps(hit, _mm_cmpgt_ps(dist, _mm_setzero_ps())));
+        }
+        return hit;
+    }
+
+    unsigned int sseIntersectBounds(const RayPacket& packet, unsigned int laneMask, const float* bounds) {
+        __m128 tNear, tFar;
+        slab(packet, bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5], tNear, tFar);
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpge_ps(tFar, _mm_setzero_ps()));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(tNear, _mm_load_ps(packet.tMax)));
+        return static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(hit, laneMaskToVector(laneMask))));
+    }
+
+    unsigned int sseIntersectBoxes(RayPacket& packet, unsigned int laneMask, const BoxArrays& boxes,
+                                   int start, int count, int idOffset, bool anyHit) {
+        unsigned int hitMask = 0;
+        for (int box = start; box < start + count && laneMask != 0; box++) {
+            __m128 tNear, tFar;
+            slab(packet, boxes.minX[box], boxes.minY[box], boxes.minZ[box], boxes.maxX[box], boxes.maxY[box], boxes.maxZ[box], tNear, tFar);
+            __m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpge_ps(tFar, _mm_setzero_ps()));
+            hit = _mm_and_ps(hit, laneMaskToVector(laneMask));
+
+            int id = idOffset + box;
+            hitMask |= record(packet, acceptLanes(packet, hit, tNear, id, anyHit), tNear, id, laneMask, anyHit);
+        }
+        return hitMask;
+    }
+
+    unsigned int sseIntersectSpheres(RayPacket& packet, unsigned int laneMask, const SphereArrays& spheres,
+                                     int start, int count, int idOffset, bool anyHit) {
+        __m128 dX = _mm_load_ps(packet.directionX);
+        __m128 dY = _mm_load_ps(packet.directionY);
+        __m128 dZ = _mm_load_ps(packet.directionZ);
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dX, dX), _mm_mul_ps(dY, dY)), _mm_mul_ps(dZ, dZ));
+        __m128 twoA = _mm_mul_ps(_mm_set1_ps(2.0f), a);
+
+        unsigned int hitMask = 0;
+        for (int sphere = start; sphere < start + count && laneMask != 0; sphere++) {
+            __m128 ocX = _mm_sub_ps(_mm_load_ps(packet.originX), _mm_set1_ps(spheres.centerX[sphere]));
+            __m128 ocY = _mm_sub_ps(_mm_load_ps(packet.originY), _mm_set1_ps(spheres.centerY[sphere]));
+            __m128 ocZ = _mm_sub_ps(_mm_load_ps(packet.originZ), _mm_set1_ps(spheres.centerZ[sphere]));
+            __m128 radius = _mm_set1_ps(spheres.radius[sphere]);
+
+            __m128 b = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, dX), _mm_mul_ps(ocY, dY)), _mm_mul_ps(ocZ, dZ)));
+            __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, ocX), _mm_mul_ps(ocY, ocY)), _mm_mul_ps(ocZ, ocZ)), _mm_mul_ps(radius, radius));
+            __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), a), c));
+            __m128 hit = _mm_cmpge_ps(discriminant, _mm_setzero_ps());
+
+            // Lanes that miss take the square root of zero instead of a negative number
+            __m128 root = _mm_sqrt_ps(_mm_and_ps(hit, discriminant));
+            __m128 dist = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), root), twoA);
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(dist, _mm_setzero_ps()));
+            hit = _mm_and_ps(hit, laneMaskToVector(laneMask));
+
+            int id = idOffset + sphere;
+            hitMask |= record(packet, acceptLanes(packet, hit, dist, id, anyHit), dist, id, laneMask, anyHit);
+        }
+        return hitMask;
+    }
+}
+
+const PacketKernels* ssePacketKernelTable() {
+    static const PacketKernels kernels = {"sse", SSE_WIDTH, sseIntersectBounds, sseIntersectBoxes, sseIntersectSpheres};
+    return &kernels;
+}
+
+#else
+
+const PacketKernels* ssePacketKernelTable() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#include "radiance.h"
+#include <cmath>
+
+namespace {
+    std::array<float, 256> makeSrgbToLinearTable() {
+        std::array<float, 256> table;
+        for (int i = 0; i < 256; i++) {
+            float value = i / 255.0f;
+            table[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }
+}
+
+const std::array<float, 256> srgbToLinearTable = makeSrgbToLinearTable();
+
+Uint8 linearToSrgb(float value) {
+    value = std::clamp(value, 0.0f, 1.0f);
+    float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<Uint8>(encoded * 255.0f + 0.5f);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include "glm/glm.hpp"
+#include "color.h"
+
+// Linear-light RGB radiance, unbounded. w is padding so that a value fills one
+// 16-byte SIMD register. Shading works in Radiance; the framebuffer tonemaps and
+// quantizes to 8-bit sRGB once per frame.
+using Radiance = glm::vec4;
+
+extern const std::array<float, 256> srgbToLinearTable;
+
+inline float srgbToLinear(Uint8 value) {
+    return srgbToLinearTable[value];
+}
+
+// Exact sRGB encoding of a linear value, clamped to [0, 1]
+Uint8 linearToSrgb(float value);
+
+inline Radiance toRadiance(const Color& color) {
+    return Radiance(srgbToLinear(color.r), srgbToLinear(color.g), srgbToLinear(color.b), 0.0f);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+// Ray with its reciprocal direction and per-axis direction signs computed once, so
+// slab tests against many boxes multiply instead of divide and pick the near plane
+// of each axis by index instead of comparing and swapping.
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 invDirection;
+    // 1 where the direction is negative: the near plane on that axis is the max one
+    int sign[3];
+
+    Ray(const glm::vec3& origin, const glm::vec3& direction)
+            : origin(origin), direction(direction), invDirection(1.0f / direction) {
+        sign[0] = invDirection.x < 0.0f;
+        sign[1] = invDirection.y < 0.0f;
+        sign[2] = invDirection.z < 0.0f;
+    }
+};
+
+// Ray cone, a one-number ray differential: the footprint of a pixel grows by
+// spreadAngle per unit of distance, starting from width at the ray origin.
+struct RayCone {
+    float width = 0.0f;
+    float spreadAngle = 0.0f;
+
+    float widthAt(float dist) const { return width + spreadAngle * dist; }
+
+    // Cone of a ray leaving a hit dist away. Flat faces keep the spread; the extra
+    // spread from curved mirrors and from refraction is ignored.
+    RayCone bounce(float dist) const { return RayCone{widthAt(dist), spreadAngle}; }
+};
@@ -0,0 +1,1525 @@
+#include "renderer.h"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include "intersect.h"
+
+int screenWidth = 800;
+int screenHeight = 600;
+float fieldOfView = 3.1415 / 3;
+int samplesPerPixel = 1;
+bool bilinearTextures = false;
+bool mipmapping = true;
+int maxDepth = 1;
+bool wavefront = false;
+bool occluderCache = true;
+int lightSamples = 1;
+bool rayCulling = true;
+Tonemap tonemap = Tonemap::Clamp;
+float exposure = 1.0f;
+unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+std::vector<Object*> objects;
+Scene scene;
+VoxelWorld* world = nullptr;
+const PacketKernels* packetKernels = bestPacketKernels();
+Framebuffer framebuffer(screenWidth, screenHeight);
+Light light(glm::vec3(-5.0, 6.0, 15.0f), 1.5f, Color(255, 255, 255));
+LightTree lights;
+Camera camera(glm::vec3(-5.0, 3.0, 15.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 10.0f);
+Skybox* skybox = nullptr;
+
+namespace {
+    std::atomic<unsigned long long> primaryRays{0};
+    std::atomic<unsigned long long> secondaryRays{0};
+    std::atomic<unsigned long long> shadowRays{0};
+    // Counted per thread while a tile renders
+    thread_local RayStats tileRays;
+
+    // Last scene primitive and voxel cell that blocked a shadow ray on this thread.
+    // Neighbouring pixels are usually shadowed by the same block, so it is tested first.
+    struct OccluderCache {
+        int primitive = -1;
+        glm::ivec3 block = glm::ivec3(-1);
+    };
+    thread_local OccluderCache lastOccluder;
+}
+
+RayStats rayStats() {
+    RayStats stats;
+    stats.primary = primaryRays;
+    stats.secondary = secondaryRays;
+    stats.shadow = shadowRays;
+    return stats;
+}
+
+void resetRayStats() {
+    primaryRays = 0;
+    secondaryRays = 0;
+    shadowRays = 0;
+}
+
+
+// Mip level covering the cone footprint at a hit; the footprint stretches as the
+// surface tilts away from the ray
+inline float textureLod(const Texture& texture, const Intersect& intersect, const glm::vec3& rayDirection, const RayCone& cone) {
+    float cosine = std::max(std::abs(glm::dot(intersect.normal, rayDirection)), 0.001f);
+    float texels = cone.width * intersect.uvScale * std::max(texture.getWidth(), texture.getHeight()) / cosine;
+    return Texture::lodForFootprint(texels);
+}
+
+inline Radiance SurfaceColor(const Texture& texture, float u, float v, float lod) {
+    return bilinearTextures ? texture.sampleBilinear(u, v, lod) : texture.sample(u, v, lod);
+}
+
+
+// Takes a direction through the hit object's normal matrix; nullptr means identity
+inline glm::vec3 toObjectSpace(const glm::mat3* normalMatrix, const glm::vec3& direction) {
+    return normalMatrix != nullptr ? *normalMatrix * direction : direction;
+}
+
+// Light reaching a point lightDist from the light whose shadow ray hit something
+// occluderDist away. Only occluders in front of the light count, so the ratio is below 1.
+inline float shadowAttenuation(float occluderDist, float lightDist) {
+    return 1.0f - occluderDist / lightDist;
+}
+
+// Without occluderCache every shadow query starts from an empty cache
+inline void startShadowQuery() {
+    if (!occluderCache) {
+        lastOccluder = OccluderCache();
+    }
+}
+
+// Shadow of the voxel world on a point the scene leaves lit
+float blockShadow(const glm::vec3& shadowOrigin, const glm::vec3& lightDir, float lightDist) {
+    float occluderDist;
+    if (world != nullptr && world->anyHit(shadowOrigin, lightDir, lightDist, occluderDist, lastOccluder.block)) {
+        return shadowAttenuation(occluderDist, lightDist);
+    }
+    return 1.0f;
+}
+
+float castShadow(const glm::vec3& shadowOrigin, const glm::vec3& lightDir, int hitPrimitive) {
+    tileRays.shadow++;
+    startShadowQuery();
+    float lightDist = glm::length(light.position - shadowOrigin);
+    float occluderDist;
+    if (scene.anyHit(shadowOrigin, lightDir, hitPrimitive, lightDist, occluderDist, lastOccluder.primitive)) {
+        return shadowAttenuation(occluderDist, lightDist);
+    }
+    return blockShadow(shadowOrigin, lightDir, lightDist);
+}
+
+// Lane `lane` of a shadow packet, cut off at the light
+inline void setShadowRay(RayPacket& shadow, int lane, const SceneHit& hit, const glm::vec3& lightDir) {
+    shadow.setRay(lane, hit.intersect.point, lightDir, hit.primitive);
+    shadow.tMax[lane] = glm::length(light.position - hit.intersect.point);
+}
+
+// Shadow intensity of each lane of a traced shadow packet; lanes the scene leaves lit
+// try the voxel world
+inline float packetShadow(const RayPacket& shadow, unsigned int occluded, int lane, const glm::vec3& point, const glm::vec3& lightDir) {
+    float lightDist = glm::length(light.position - point);
+    if (occluded & (1u << lane)) {
+        return shadowAttenuation(shadow.tMax[lane], lightDist);
+    }
+    return blockShadow(point, lightDir, lightDist);
+}
+
+// Lets a voxel block in front of the scene hit (or any block, on a miss) replace it.
+// A block hit has primitive -1 and materialId -1 - its block ID.
+void traceVoxelWorld(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, SceneHit& hit,
+                     const Material*& hitMaterial, const glm::mat3*& normalMatrix) {
+    if (world == nullptr) {
+        return;
+    }
+    Intersect blockIntersect;
+    Uint8 blockId;
+    float maxDist = hit.intersect.isIntersecting ? hit.intersect.dist : std::numeric_limits<float>::max();
+    if (world->rayIntersect(rayOrigin, rayDirection, blockIntersect, blockId, maxDist)) {
+        hit.intersect = blockIntersect;
+        hit.primitive = -1;
+        hit.materialId = -1 - blockId;
+        hitMaterial = &world->getMaterial(blockId);
+        normalMatrix = nullptr;
+    }
+}
+
+// Random numbers are hashed from ray data instead of drawn from a generator, so a
+// frame doesn't depend on which thread traced what
+inline Uint32 hashVector(const glm::vec3& vector) {
+    return std::bit_cast<Uint32>(vector.x) * 0x9E3779B1u ^ std::bit_cast<Uint32>(vector.y) * 0x85EBCA77u ^
+           std::bit_cast<Uint32>(vector.z) * 0xC2B2AE3Du;
+}
+
+inline Uint32 mixHash(Uint32 hash) {
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+// Uniform in [0, 1) from the top 24 bits
+inline float unitFloat(Uint32 hash) {
+    return static_cast<float>(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+// Diffuse light from one point of `sampled`, reaching the hit unless something blocks it
+Radiance lightFrom(const Light& sampled, const glm::vec3& shadowOrigin, const glm::vec3& normal, float u, float v) {
+    LightSample sample;
+    if (!sampleLight(sampled, shadowOrigin, u, v, sample)) {
+        return Radiance(0.0f);
+    }
+    float cosine = glm::dot(normal, sample.direction);
+    if (cosine <= 0.0f) {
+        return Radiance(0.0f);
+    }
+
+    tileRays.shadow++;
+    startShadowQuery();
+    // Stops short of the light, whose own block would otherwise occlude it
+    float maxDist = sample.distance * 0.999f;
+    float occluderDist;
+    if (scene.anyHit(shadowOrigin, sample.direction, -1, maxDist, occluderDist, lastOccluder.primitive) ||
+        (world != nullptr && world->anyHit(shadowOrigin, sample.direction, maxDist, occluderDist, lastOccluder.block))) {
+        return Radiance(0.0f);
+    }
+    return sample.radiance * cosine;
+}
+
+// Diffuse light from the light tree at a hit, before the surface color and albedo.
+// Averages lightSamples lights picked from the tree, each weighted by one over its
+// probability, or sums every light with lightSamples 0.
+Radiance treeLight(const glm::vec3& rayDirection, const Intersect& intersect) {
+    glm::vec3 shadowOrigin = intersect.point + intersect.normal * BIAS;
+    Uint32 hash = mixHash(hashVector(intersect.point) ^ mixHash(hashVector(rayDirection)));
+    Radiance total(0.0f);
+    if (lightSamples == 0) {
+        for (int index = 0; index < lights.size(); index++) {
+            hash = mixHash(hash + 0x9E3779B9u);
+            float u = unitFloat(hash);
+            hash = mixHash(hash + 0x9E3779B9u);
+            total += lightFrom(lights.getLight(index), shadowOrigin, intersect.normal, u, unitFloat(hash));
+        }
+        return total;
+    }
+
+    for (int sample = 0; sample < lightSamples; sample++) {
+        hash = mixHash(hash + 0x9E3779B9u);
+        float probability;
+        int index = lights.pick(intersect.point, unitFloat(hash), probability);
+        if (index < 0) {
+            continue;
+        }
+        hash = mixHash(hash + 0x9E3779B9u);
+        float u = unitFloat(hash);
+        hash = mixHash(hash + 0x9E3779B9u);
+        total += lightFrom(lights.getLight(index), shadowOrigin, intersect.normal, u, unitFloat(hash)) / probability;
+    }
+    return total / static_cast<float>(lightSamples);
+}
+
+inline glm::vec3 lightDirection(const Intersect& intersect, const glm::mat3* normalMatrix) {
+    return toObjectSpace(normalMatrix, glm::normalize(light.position - intersect.point));
+}
+
+// Diffuse light at a hit. Only the texture's mip level depends on where the ray came from.
+inline Radiance diffuseLight(const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+                             const glm::vec3& lightDir, float shadowIntensity, const RayCone& cone) {
+    Radiance diffuseC;
+    if (material.texture != nullptr) {
+        diffuseC = SurfaceColor(*material.texture, intersect.u, intersect.v, textureLod(*material.texture, intersect, rayDirection, cone));
+    } else {
+        diffuseC = toRadiance(material.diffuse);
+    }
+    float diffuseLightIntensity = glm::max(0.0f, glm::dot(intersect.normal, lightDir));
+    Radiance color = diffuseC * (light.intensity * diffuseLightIntensity * material.albedo * shadowIntensity);
+    if (!lights.empty()) {
+        color += diffuseC * treeLight(rayDirection, intersect) * material.albedo;
+    }
+    return color;
+}
+
+// Share of a hit's color that is local light rather than reflected or refracted
+inline float localWeight(const Material& material) {
+    return 1.0f - material.reflectivity - material.transparency;
+}
+
+inline Radiance specularLight(const glm::vec3& rayOrigin, const Intersect& intersect, const Material& material,
+                              const glm::mat3* normalMatrix, const glm::vec3& lightDir, float shadowIntensity) {
+    glm::vec3 viewDir = toObjectSpace(normalMatrix, glm::normalize(rayOrigin - intersect.point));
+    glm::vec3 reflectDir = glm::reflect(-lightDir, intersect.normal);
+    float specLightIntensity = std::pow(glm::max(0.0f, glm::dot(viewDir, reflectDir)), material.specularCoefficient);
+    return toRadiance(light.color) * (light.intensity * specLightIntensity * material.specularAlbedo * shadowIntensity);
+}
+
+namespace {
+    // A reflected or refracted ray waiting to be traced; weight is its share of the pixel
+    struct PendingRay {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        // As the ray leaves its origin
+        RayCone cone;
+        float weight;
+        int depth;
+    };
+
+    // Rays are traced depth first, so at most one sibling per depth waits here
+    class RayStack {
+    public:
+        void push(const PendingRay& ray) { rays[size++] = ray; }
+
+        bool pop(PendingRay& ray) {
+            if (size == 0) {
+                return false;
+            }
+            ray = rays[--size];
+            return true;
+        }
+
+    private:
+        PendingRay rays[MAX_DEPTH_LIMIT + 2];
+        int size = 0;
+    };
+}
+
+// Uniform in [0, 1), hashed from the ray direction so that roulette decides the same
+// way whichever thread traces the ray
+inline float rouletteSample(const glm::vec3& direction) {
+    return unitFloat(mixHash(hashVector(direction)));
+}
+
+// Weight of a secondary ray carrying `share` of a hit reached with `weight`; false when
+// the ray is dropped. With culling, negligible rays are dropped and weak ones deep in
+// the path play Russian roulette: survivors carry ROULETTE_WEIGHT, which keeps the
+// expected light unchanged. Rays at maxDepth only look up the sky, so roulette would add
+// noise without saving anything.
+inline bool secondaryRayWeight(const glm::vec3& direction, float weight, float share, int depth, float& rayWeight) {
+    rayWeight = weight * share;
+    if (rayCulling) {
+        if (rayWeight < MIN_RAY_WEIGHT) {
+            return false;
+        }
+        if (depth >= ROULETTE_DEPTH && depth < maxDepth && rayWeight < ROULETTE_WEIGHT) {
+            if (rouletteSample(direction) * ROULETTE_WEIGHT >= rayWeight) {
+                return false;
+            }
+            rayWeight = ROULETTE_WEIGHT;
+        }
+    }
+    return true;
+}
+
+inline void reflectedRay(const Intersect& intersect, const glm::mat3* normalMatrix, const glm::vec3& lightDir,
+                         glm::vec3& origin, glm::vec3& direction) {
+    origin = intersect.point + intersect.normal * BIAS;
+    direction = toObjectSpace(normalMatrix, glm::reflect(-lightDir, intersect.normal));
+}
+
+inline void refractedRay(const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+                         const glm::mat3* normalMatrix, glm::vec3& origin, glm::vec3& direction) {
+    origin = intersect.point - intersect.normal * BIAS;
+    direction = toObjectSpace(normalMatrix, glm::refract(rayDirection, intersect.normal, material.refractionIndex));
+}
+
+// Queues the reflected and refracted rays of a hit reached with `weight` at `depth`.
+// Refraction goes first so that reflection is traced, and added, first.
+void queueSecondaryRays(RayStack& rays, const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+                        const glm::mat3* normalMatrix, const glm::vec3& lightDir, float weight, int depth, const RayCone& cone) {
+    glm::vec3 origin, direction;
+    float rayWeight;
+    if (material.transparency > 0) {
+        refractedRay(rayDirection, intersect, material, normalMatrix, origin, direction);
+        if (secondaryRayWeight(direction, weight, material.transparency, depth + 1, rayWeight)) {
+            rays.push(PendingRay{origin, direction, cone, rayWeight, depth + 1});
+        }
+    }
+    if (material.reflectivity > 0) {
+        reflectedRay(intersect, normalMatrix, lightDir, origin, direction);
+        if (secondaryRayWeight(direction, weight, material.reflectivity, depth + 1, rayWeight)) {
+            rays.push(PendingRay{origin, direction, cone, rayWeight, depth + 1});
+        }
+    }
+}
+
+// Adds a hit's local light, scaled by weight, to color and queues its secondary rays
+void shadeHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+              const glm::mat3* normalMatrix, const glm::vec3& lightDir, float shadowIntensity, float weight, int depth,
+              const RayCone& cone, RayStack& rays, Radiance& color) {
+    Radiance diffuseL = diffuseLight(rayDirection, intersect, material, lightDir, shadowIntensity, cone);
+    Radiance SpecularL = specularLight(rayOrigin, intersect, material, normalMatrix, lightDir, shadowIntensity);
+    color += (diffuseL + SpecularL) * (localWeight(material) * weight);
+    queueSecondaryRays(rays, rayDirection, intersect, material, normalMatrix, lightDir, weight, depth, cone);
+}
+
+// Traces queued rays until none are left, adding the weighted light of each to color.
+// Rays at maxDepth aren't traced and see the sky.
+void traceRays(RayStack& rays, Radiance& color) {
+    PendingRay ray;
+    while (rays.pop(ray)) {
+        if (ray.depth >= maxDepth) {
+            color += skybox->getColor(ray.direction, ray.cone.spreadAngle) * ray.weight;
+            continue;
+        }
+        if (ray.depth == 0) {
+            tileRays.primary++;
+        } else {
+            tileRays.secondary++;
+        }
+        SceneHit hit;
+        const Material* hitMaterial = nullptr;
+        const glm::mat3* normalMatrix = nullptr;
+        if (scene.closestHit(ray.origin, ray.direction, hit)) {
+            hitMaterial = &scene.getMaterial(hit.materialId);
+            // nullptr for untransformed objects, which skip the matrix entirely
+            normalMatrix = scene.getNormalMatrix(hit.primitive);
+        }
+        traceVoxelWorld(ray.origin, ray.direction, hit, hitMaterial, normalMatrix);
+        const Intersect& intersect = hit.intersect;
+
+        if (!intersect.isIntersecting) {
+            color += skybox->getColor(ray.direction, ray.cone.spreadAngle) * ray.weight;
+            continue;
+        }
+
+        glm::vec3 lightDir = lightDirection(intersect, normalMatrix);
+        float shadowIntensity = castShadow(intersect.point, lightDir, hit.primitive);
+        shadeHit(ray.origin, ray.direction, intersect, *hitMaterial, normalMatrix, lightDir, shadowIntensity, ray.weight, ray.depth,
+                 ray.cone.bounce(intersect.dist), rays, color);
+    }
+}
+
+// Specular highlight plus reflected and refracted rays of a primary hit: the terms that
+// change with the view
+Radiance viewDependentLight(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+                            const glm::mat3* normalMatrix, const glm::vec3& lightDir, float shadowIntensity, const RayCone& cone) {
+    Radiance color = specularLight(rayOrigin, intersect, material, normalMatrix, lightDir, shadowIntensity) * localWeight(material);
+    RayStack rays;
+    queueSecondaryRays(rays, rayDirection, intersect, material, normalMatrix, lightDir, 1.0f, 0, cone);
+    traceRays(rays, color);
+    return color;
+}
+
+// Local lighting plus reflected and refracted rays for a resolved hit at `depth`; cone
+// is the ray cone as it leaves the hit
+Radiance shade(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Intersect& intersect, const Material& material,
+               const glm::mat3* normalMatrix, const glm::vec3& lightDir, float shadowIntensity, int depth, const RayCone& cone) {
+    RayStack rays;
+    Radiance color(0.0f);
+    shadeHit(rayOrigin, rayDirection, intersect, material, normalMatrix, lightDir, shadowIntensity, 1.0f, depth, cone, rays, color);
+    traceRays(rays, color);
+    return color;
+}
+
+Radiance castRay(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, int depth, const RayCone& cone) {
+    RayStack rays;
+    rays.push(PendingRay{rayOrigin, rayDirection, cone, 1.0f, depth});
+    Radiance color(0.0f);
+    traceRays(rays, color);
+    return color;
+}
+
+
+// Camera basis for one frame, captured before the tiles are handed to the pool
+struct View {
+    glm::vec3 position;
+    glm::vec3 direction;
+    glm::vec3 right;
+    glm::vec3 up;
+    float tanHalfFov;
+    float aspectRatio;
+    // Primary ray cone: one pixel's angular size, or a zero cone (full resolution) without mipmapping
+    RayCone pixelCone;
+};
+
+View makeView() {
+    View view;
+    view.position = camera.position;
+    view.direction = glm::normalize(camera.target - camera.position);
+    view.right = glm::normalize(glm::cross(view.direction, camera.up));
+    view.up = glm::normalize(glm::cross(view.right, view.direction));
+    view.tanHalfFov = tan(fieldOfView / 2.0f);
+    view.aspectRatio = static_cast<float>(screenWidth) / static_cast<float>(screenHeight);
+    if (mipmapping) {
+        view.pixelCone.spreadAngle = 2.0f * view.tanHalfFov / static_cast<float>(screenHeight);
+    }
+    return view;
+}
+
+// What a primary ray hit, to tell surfaces apart: the primitive index, a hash of the
+// voxel cell below -2, or -1 for the sky
+inline int surfaceId(const SceneHit& hit) {
+    if (!hit.intersect.isIntersecting) {
+        return -1;
+    }
+    if (hit.primitive >= 0) {
+        return hit.primitive;
+    }
+    // Blocks are told apart by the cell behind the face that was hit
+    glm::ivec3 cell(glm::floor(hit.intersect.point - hit.intersect.normal * 0.5f));
+    unsigned int hash = static_cast<unsigned int>(cell.x) * 73856093u ^ static_cast<unsigned int>(cell.y) * 19349663u ^
+                        static_cast<unsigned int>(cell.z) * 83492791u;
+    return -2 - static_cast<int>(hash & 0x3FFFFFFFu);
+}
+
+// Direction through (x + offsetX, y + offsetY); the pixel center is offset 0.5, 0.5
+inline glm::vec3 primaryRayDirection(const View& view, int x, int y, float offsetX, float offsetY) {
+    float screenX = (2.0f * (x + offsetX)) / screenWidth - 1.0f;
+    float screenY = -(2.0f * (y + offsetY)) / screenHeight + 1.0f;
+    screenX *= view.aspectRatio;
+    screenX *= view.tanHalfFov;
+    screenY *= view.tanHalfFov;
+
+    return glm::normalize(
+            view.direction + view.right * screenX + view.up * screenY
+    );
+}
+
+// Traces one ray per pixel of the tile into colors (row-major, x1 - x0 wide)
+void traceTile(int x0, int y0, int x1, int y1, const View& view, float offsetX, float offsetY, Radiance* colors) {
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            glm::vec3 rayDirection = primaryRayDirection(view, x, y, offsetX, offsetY);
+            colors[(y - y0) * (x1 - x0) + (x - x0)] = castRay(view.position, rayDirection, 0, view.pixelCone);
+        }
+    }
+}
+
+// Shadow rays for up to a packet's worth of resolved primary hits, traced as one packet,
+// then shade() for each lane in activeMask; lanes whose ray hit nothing get the sky
+void shadePrimaryHits(const glm::vec3& origin, const glm::vec3* directions, const SceneHit* hits, const Material* const* hitMaterials,
+                      const glm::mat3* const* normalMatrices, unsigned int activeMask, const RayCone& pixelCone,
+                      const PacketKernels& kernels, Radiance* colors) {
+    glm::vec3 lightDirs[RayPacket::MAX_WIDTH];
+    RayPacket shadow;
+    for (int lane = 0; lane < kernels.width; lane++) {
+        if ((activeMask & (1u << lane)) && hits[lane].intersect.isIntersecting && maxDepth > 0) {
+            lightDirs[lane] = lightDirection(hits[lane].intersect, normalMatrices[lane]);
+            setShadowRay(shadow, lane, hits[lane], lightDirs[lane]);
+        }
+    }
+    startShadowQuery();
+    unsigned int occluded = shadow.activeMask != 0 ? scene.anyHitPacket(shadow, kernels, lastOccluder.primitive) : 0;
+    tileRays.shadow += std::popcount(shadow.activeMask);
+
+    for (int lane = 0; lane < kernels.width; lane++) {
+        if (!(activeMask & (1u << lane))) {
+            continue;
+        }
+        const Intersect& intersect = hits[lane].intersect;
+
+        if (!(shadow.activeMask & (1u << lane))) {
+            colors[lane] = skybox->getColor(directions[lane], pixelCone.spreadAngle);
+            continue;
+        }
+        float shadowIntensity = packetShadow(shadow, occluded, lane, intersect.point, lightDirs[lane]);
+        colors[lane] = shade(origin, directions[lane], intersect, *hitMaterials[lane], normalMatrices[lane],
+                             lightDirs[lane], shadowIntensity, 0, pixelCone.bounce(intersect.dist));
+    }
+}
+
+// Intersects a packet of primary rays and resolves its lanes to full hits. Returns the
+// lanes in use.
+unsigned int traceRayPacket(RayPacket& primary, const View& view, const PacketKernels& kernels, SceneHit* hits,
+                            const Material** hitMaterials, const glm::mat3** normalMatrices, glm::vec3* directions) {
+    scene.closestHitPacket(primary, kernels);
+    tileRays.primary += std::popcount(primary.activeMask);
+
+    for (int lane = 0; lane < kernels.width; lane++) {
+        if (!(primary.activeMask & (1u << lane))) {
+            continue;
+        }
+        directions[lane] = glm::vec3(primary.directionX[lane], primary.directionY[lane], primary.directionZ[lane]);
+        if (primary.primitive[lane] >= 0) {
+            hits[lane] = scene.surfaceAt(primary.primitive[lane], primary.tMax[lane], view.position, directions[lane]);
+            hitMaterials[lane] = &scene.getMaterial(hits[lane].materialId);
+            normalMatrices[lane] = scene.getNormalMatrix(hits[lane].primitive);
+        }
+        traceVoxelWorld(view.position, directions[lane], hits[lane], hitMaterials[lane], normalMatrices[lane]);
+    }
+    return primary.activeMask;
+}
+
+// Primary rays of the packet whose top-left pixel is (x, y), clipped to x1 and y1,
+// resolved to full hits. Returns the lanes in use.
+unsigned int tracePrimaryPacket(int x, int y, int x1, int y1, const View& view, float offsetX, float offsetY,
+                                const PacketKernels& kernels, SceneHit* hits, const Material** hitMaterials,
+                                const glm::mat3** normalMatrices, glm::vec3* directions) {
+    const int packetWidth = kernels.width / 2;
+    RayPacket primary;
+    for (int lane = 0; lane < kernels.width; lane++) {
+        int px = x + lane % packetWidth;
+        int py = y + lane / packetWidth;
+        if (px < x1 && py < y1) {
+            primary.setRay(lane, view.position, primaryRayDirection(view, px, py, offsetX, offsetY));
+        }
+    }
+    return traceRayPacket(primary, view, kernels, hits, hitMaterials, normalMatrices, directions);
+}
+
+// Same colors as traceTile(), but primary and shadow rays go through the scene as
+// packets of 2x2 (4 lanes) or 4x2 (8 lanes) pixels. Reflections, refractions and
+// the voxel world stay on the per-ray path.
+void traceTilePackets(int x0, int y0, int x1, int y1, const View& view, float offsetX, float offsetY, Radiance* colors,
+                      const PacketKernels& kernels) {
+    const int packetWidth = kernels.width / 2;
+    const int packetHeight = 2;
+
+    for (int y = y0; y < y1; y += packetHeight) {
+        for (int x = x0; x < x1; x += packetWidth) {
+            SceneHit hits[RayPacket::MAX_WIDTH];
+            const Material* hitMaterials[RayPacket::MAX_WIDTH] = {};
+            const glm::mat3* normalMatrices[RayPacket::MAX_WIDTH] = {};
+            glm::vec3 directions[RayPacket::MAX_WIDTH];
+            unsigned int activeMask = tracePrimaryPacket(x, y, x1, y1, view, offsetX, offsetY, kernels, hits, hitMaterials,
+                                                         normalMatrices, directions);
+
+            Radiance laneColors[RayPacket::MAX_WIDTH];
+            shadePrimaryHits(view.position, directions, hits, hitMaterials, normalMatrices, activeMask, view.pixelCone,
+                             kernels, laneColors);
+            for (int lane = 0; lane < kernels.width; lane++) {
+                if (activeMask & (1u << lane)) {
+                    int px = x + lane % packetWidth;
+                    int py = y + lane / packetWidth;
+                    colors[(py - y0) * (x1 - x0) + (px - x0)] = laneColors[lane];
+                }
+            }
+        }
+    }
+}
+
+// Sub-pixel offset of sample `index` in an R2 low-discrepancy sequence, so any
+// number of samples covers the pixel evenly. Sample 0 is the pixel center.
+inline void jitterOffset(int index, float& offsetX, float& offsetY) {
+    offsetX = std::fmod(0.5f + index * 0.7548776662f, 1.0f);
+    offsetY = std::fmod(0.5f + index * 0.5698402910f, 1.0f);
+}
+
+// The pixel center for one sample, otherwise jitterOffset()
+inline void sampleOffset(int index, int sampleCount, float& offsetX, float& offsetY) {
+    if (sampleCount == 1) {
+        offsetX = 0.5f;
+        offsetY = 0.5f;
+        return;
+    }
+    jitterOffset(index, offsetX, offsetY);
+}
+
+// Traces the tile's samples at the given offset through the packet or per-ray path
+void traceTileSample(int x0, int y0, int x1, int y1, const View& view, float offsetX, float offsetY, Radiance* colors) {
+    if (packetKernels != nullptr) {
+        traceTilePackets(x0, y0, x1, y1, view, offsetX, offsetY, colors, *packetKernels);
+    } else {
+        traceTile(x0, y0, x1, y1, view, offsetX, offsetY, colors);
+    }
+}
+
+// Called at the end of every tile. Adds this thread's counts to the totals (once per
+// tile keeps the atomics uncontended) and empties the occluder cache, so that a tile
+// renders the same whichever thread ran what before it.
+void finishTile() {
+    primaryRays += tileRays.primary;
+    secondaryRays += tileRays.secondary;
+    shadowRays += tileRays.shadow;
+    tileRays = RayStats();
+    lastOccluder = OccluderCache();
+}
+
+void renderTile(int x0, int y0, int x1, int y1, const View& view) {
+    Radiance colors[TILE_SIZE * TILE_SIZE];
+    int tileWidth = x1 - x0;
+    int pixelCount = tileWidth * (y1 - y0);
+
+    auto trace = [&](int sample) {
+        float offsetX, offsetY;
+        sampleOffset(sample, samplesPerPixel, offsetX, offsetY);
+        traceTileSample(x0, y0, x1, y1, view, offsetX, offsetY, colors);
+    };
+
+    if (samplesPerPixel == 1) {
+        trace(0);
+        for (int i = 0; i < pixelCount; i++) {
+            framebuffer.setRadiance(x0 + i % tileWidth, y0 + i / tileWidth, colors[i]);
+        }
+        finishTile();
+        return;
+    }
+
+    // Box-filtered average of all samples, in linear radiance
+    Radiance sums[TILE_SIZE * TILE_SIZE] = {};
+    for (int sample = 0; sample < samplesPerPixel; sample++) {
+        trace(sample);
+        for (int i = 0; i < pixelCount; i++) {
+            sums[i] += colors[i];
+        }
+    }
+    float weight = 1.0f / samplesPerPixel;
+    for (int i = 0; i < pixelCount; i++) {
+        framebuffer.setRadiance(x0 + i % tileWidth, y0 + i / tileWidth, sums[i] * weight);
+    }
+    finishTile();
+}
+
+// Runs tileFunction(x0, y0, x1, y1) for every TILE_SIZE tile on the pool and waits
+template<typename TileFunction>
+void forEachTile(ThreadPool& pool, const TileFunction& tileFunction) {
+    for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+        for (int x0 = 0; x0 < screenWidth; x0 += TILE_SIZE) {
+            int x1 = std::min(x0 + TILE_SIZE, screenWidth);
+            int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+            pool.submit([=, &tileFunction] {
+                tileFunction(x0, y0, x1, y1);
+            });
+        }
+    }
+    pool.wait();
+}
+
+// forEachTile(), then one tonemap and quantize pass over the frame in bands of tile rows
+template<typename TileFunction>
+void renderTiles(ThreadPool& pool, const TileFunction& tileFunction) {
+    forEachTile(pool, tileFunction);
+
+    for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+        int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+        pool.submit([=] {
+            framebuffer.resolve(0, y0, screenWidth, y1, tonemap, exposure);
+        });
+    }
+    pool.wait();
+}
+
+namespace {
+    // A ray of the current wave: a primary ray, or a reflected or refracted one
+    struct WaveRay {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        // As the ray leaves its origin
+        RayCone cone;
+        float weight;
+        // Index into the band's radiance
+        int pixel;
+        int depth;
+    };
+
+    struct WaveHit {
+        SceneHit hit;
+        const Material* material;
+        const glm::mat3* normalMatrix;
+        glm::vec3 lightDir;
+        float shadowIntensity;
+    };
+
+    // One thread's buffers, kept between bands so a frame allocates nothing after the first
+    struct Wavefront {
+        std::vector<WaveRay> rays;
+        std::vector<WaveRay> nextRays;
+        std::vector<WaveHit> hits;
+        // Ray indices of the current stage in shading order
+        std::vector<int> order;
+        std::vector<int> bucketStart;
+        std::vector<int> hitIndices;
+        std::vector<Radiance> radiance;
+    };
+
+    thread_local Wavefront wave;
+
+    // Nanoseconds per stage over all threads
+    std::atomic<unsigned long long> stageNanoseconds[5];
+
+    enum WavefrontStage {
+        GenerateStage,
+        IntersectStage,
+        ShadowStage,
+        SortStage,
+        ShadeStage
+    };
+
+    class StageTimer {
+    public:
+        explicit StageTimer(WavefrontStage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+        ~StageTimer() {
+            stageNanoseconds[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        WavefrontStage stage;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+WavefrontStats wavefrontStats() {
+    WavefrontStats stats;
+    stats.generateMs = stageNanoseconds[GenerateStage] / 1e6;
+    stats.intersectMs = stageNanoseconds[IntersectStage] / 1e6;
+    stats.shadowMs = stageNanoseconds[ShadowStage] / 1e6;
+    stats.sortMs = stageNanoseconds[SortStage] / 1e6;
+    stats.shadeMs = stageNanoseconds[ShadeStage] / 1e6;
+    return stats;
+}
+
+void resetWavefrontStats() {
+    for (std::atomic<unsigned long long>& nanoseconds : stageNanoseconds) {
+        nanoseconds = 0;
+    }
+}
+
+// Stable counting sort of `count` items into `order` by key(i) in [0, keyCount)
+template<typename Key>
+void bucketSort(int count, int keyCount, const Key& key, std::vector<int>& bucketStart, std::vector<int>& order) {
+    bucketStart.assign(keyCount + 1, 0);
+    for (int i = 0; i < count; i++) {
+        bucketStart[key(i) + 1]++;
+    }
+    for (int k = 0; k < keyCount; k++) {
+        bucketStart[k + 1] += bucketStart[k];
+    }
+    order.resize(count);
+    for (int i = 0; i < count; i++) {
+        order[bucketStart[key(i)]++] = i;
+    }
+}
+
+// Primary rays of the band, kernels.width at a time from 2-row pixel blocks as in
+// traceTilePackets(), so neighbouring rays of the buffer form coherent packets
+void generatePrimaryRays(int y0, int y1, const View& view, const PacketKernels& kernels) {
+    StageTimer timer(GenerateStage);
+    const int packetWidth = kernels.width / 2;
+    const int packetHeight = 2;
+    float weight = 1.0f / samplesPerPixel;
+    wave.rays.clear();
+    for (int sample = 0; sample < samplesPerPixel; sample++) {
+        float offsetX, offsetY;
+        sampleOffset(sample, samplesPerPixel, offsetX, offsetY);
+        for (int y = y0; y < y1; y += packetHeight) {
+            for (int x = 0; x < screenWidth; x += packetWidth) {
+                for (int lane = 0; lane < kernels.width; lane++) {
+                    int px = x + lane % packetWidth;
+                    int py = y + lane / packetWidth;
+                    if (px < screenWidth && py < y1) {
+                        wave.rays.push_back(WaveRay{view.position, primaryRayDirection(view, px, py, offsetX, offsetY), view.pixelCone,
+                                                    weight, (py - y0) * screenWidth + px, 0});
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Closest hit of every ray in the wave, kernels.width rays per packet
+void intersectWave(const PacketKernels& kernels) {
+    StageTimer timer(IntersectStage);
+    int count = static_cast<int>(wave.rays.size());
+    wave.hits.resize(count);
+    for (int first = 0; first < count; first += kernels.width) {
+        int lanes = std::min(kernels.width, count - first);
+        RayPacket packet;
+        for (int lane = 0; lane < lanes; lane++) {
+            packet.setRay(lane, wave.rays[first + lane].origin, wave.rays[first + lane].direction);
+        }
+        scene.closestHitPacket(packet, kernels);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            const WaveRay& ray = wave.rays[first + lane];
+            WaveHit& waveHit = wave.hits[first + lane];
+            waveHit.hit = SceneHit();
+            waveHit.material = nullptr;
+            waveHit.normalMatrix = nullptr;
+            if (packet.primitive[lane] >= 0) {
+                waveHit.hit = scene.surfaceAt(packet.primitive[lane], packet.tMax[lane], ray.origin, ray.direction);
+                waveHit.material = &scene.getMaterial(waveHit.hit.materialId);
+                waveHit.normalMatrix = scene.getNormalMatrix(waveHit.hit.primitive);
+            }
+            traceVoxelWorld(ray.origin, ray.direction, waveHit.hit, waveHit.material, waveHit.normalMatrix);
+            if (ray.depth == 0) {
+                tileRays.primary++;
+            } else {
+                tileRays.secondary++;
+            }
+        }
+    }
+}
+
+// Shadow rays of every hit in the wave, packed kernels.width at a time
+void traceWaveShadows(const PacketKernels& kernels) {
+    StageTimer timer(ShadowStage);
+    wave.hitIndices.clear();
+    for (int i = 0; i < static_cast<int>(wave.hits.size()); i++) {
+        WaveHit& waveHit = wave.hits[i];
+        if (waveHit.hit.intersect.isIntersecting) {
+            waveHit.lightDir = lightDirection(waveHit.hit.intersect, waveHit.normalMatrix);
+            wave.hitIndices.push_back(i);
+        }
+    }
+
+    int count = static_cast<int>(wave.hitIndices.size());
+    for (int first = 0; first < count; first += kernels.width) {
+        int lanes = std::min(kernels.width, count - first);
+        RayPacket shadow;
+        for (int lane = 0; lane < lanes; lane++) {
+            const WaveHit& waveHit = wave.hits[wave.hitIndices[first + lane]];
+            setShadowRay(shadow, lane, waveHit.hit, waveHit.lightDir);
+        }
+        startShadowQuery();
+        unsigned int occluded = scene.anyHitPacket(shadow, kernels, lastOccluder.primitive);
+        tileRays.shadow += lanes;
+
+        for (int lane = 0; lane < lanes; lane++) {
+            WaveHit& waveHit = wave.hits[wave.hitIndices[first + lane]];
+            waveHit.shadowIntensity = packetShadow(shadow, occluded, lane, waveHit.hit.intersect.point, waveHit.lightDir);
+        }
+    }
+}
+
+// Adds one secondary ray to the next wave, or its sky light when it is at maxDepth
+inline void spawnWaveRay(const WaveRay& parent, const glm::vec3& origin, const glm::vec3& direction, const RayCone& cone, float share) {
+    float rayWeight;
+    if (!secondaryRayWeight(direction, parent.weight, share, parent.depth + 1, rayWeight)) {
+        return;
+    }
+    if (parent.depth + 1 >= maxDepth) {
+        wave.radiance[parent.pixel] += skybox->getColor(direction, cone.spreadAngle) * rayWeight;
+        return;
+    }
+    wave.nextRays.push_back(WaveRay{origin, direction, cone, rayWeight, parent.pixel, parent.depth + 1});
+}
+
+// Shades the wave material by material, so each material's texture stays in cache,
+// and collects the reflected and refracted rays of the next wave
+void shadeWave() {
+    int count = static_cast<int>(wave.rays.size());
+    // Misses first, then scene materials, then voxel block materials
+    int sceneMaterials = scene.materialCount();
+    {
+        StageTimer timer(SortStage);
+        bucketSort(count, 1 + sceneMaterials + 256, [&](int i) {
+            const SceneHit& hit = wave.hits[i].hit;
+            if (!hit.intersect.isIntersecting) {
+                return 0;
+            }
+            return hit.materialId >= 0 ? 1 + hit.materialId : 1 + sceneMaterials + (-1 - hit.materialId);
+        }, wave.bucketStart, wave.order);
+    }
+
+    StageTimer timer(ShadeStage);
+    wave.nextRays.clear();
+    for (int i : wave.order) {
+        const WaveRay& ray = wave.rays[i];
+        const WaveHit& waveHit = wave.hits[i];
+        const Intersect& intersect = waveHit.hit.intersect;
+        if (!intersect.isIntersecting) {
+            wave.radiance[ray.pixel] += skybox->getColor(ray.direction, ray.cone.spreadAngle) * ray.weight;
+            continue;
+        }
+
+        const Material& material = *waveHit.material;
+        RayCone cone = ray.cone.bounce(intersect.dist);
+        Radiance diffuseL = diffuseLight(ray.direction, intersect, material, waveHit.lightDir, waveHit.shadowIntensity, cone);
+        Radiance SpecularL = specularLight(ray.origin, intersect, material, waveHit.normalMatrix, waveHit.lightDir, waveHit.shadowIntensity);
+        wave.radiance[ray.pixel] += (diffuseL + SpecularL) * (localWeight(material) * ray.weight);
+
+        // Reflection before refraction, the order the per-pixel path adds them in
+        glm::vec3 origin, direction;
+        if (material.reflectivity > 0) {
+            reflectedRay(intersect, waveHit.normalMatrix, waveHit.lightDir, origin, direction);
+            spawnWaveRay(ray, origin, direction, cone, material.reflectivity);
+        }
+        if (material.transparency > 0) {
+            refractedRay(ray.direction, intersect, material, waveHit.normalMatrix, origin, direction);
+            spawnWaveRay(ray, origin, direction, cone, material.transparency);
+        }
+    }
+}
+
+// Groups the next wave by direction octant, so packets hold rays heading the same way
+void sortNextWave() {
+    StageTimer timer(SortStage);
+    int count = static_cast<int>(wave.nextRays.size());
+    bucketSort(count, 8, [&](int i) {
+        const glm::vec3& direction = wave.nextRays[i].direction;
+        return (direction.x < 0.0f) | (direction.y < 0.0f) << 1 | (direction.z < 0.0f) << 2;
+    }, wave.bucketStart, wave.order);
+    wave.rays.resize(count);
+    for (int i = 0; i < count; i++) {
+        wave.rays[i] = wave.nextRays[wave.order[i]];
+    }
+}
+
+// Renders rows [y0, y1) stage by stage: every ray of a depth is intersected, then every
+// shadow ray, then every hit is shaded, before the next depth starts
+void renderWavefrontBand(int y0, int y1, const View& view) {
+    const PacketKernels& kernels = packetKernels != nullptr ? *packetKernels : *scalarPacketKernels();
+    wave.radiance.assign(static_cast<size_t>(screenWidth) * (y1 - y0), Radiance(0.0f));
+
+    generatePrimaryRays(y0, y1, view, kernels);
+    if (maxDepth == 0) {
+        // Primary rays already at the depth limit see the sky
+        for (const WaveRay& ray : wave.rays) {
+            wave.radiance[ray.pixel] += skybox->getColor(ray.direction, ray.cone.spreadAngle) * ray.weight;
+        }
+        wave.rays.clear();
+    }
+
+    while (!wave.rays.empty()) {
+        intersectWave(kernels);
+        traceWaveShadows(kernels);
+        shadeWave();
+        sortNextWave();
+    }
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < screenWidth; x++) {
+            framebuffer.setRadiance(x, y, wave.radiance[(y - y0) * screenWidth + x]);
+        }
+    }
+    finishTile();
+}
+
+// The frame in bands of TILE_SIZE rows, each a wavefront of its own on one thread
+void renderWavefront(ThreadPool& pool) {
+    View view = makeView();
+    for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+        int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+        pool.submit([=, &view] {
+            renderWavefrontBand(y0, y1, view);
+            framebuffer.resolve(0, y0, screenWidth, y1, tonemap, exposure);
+        });
+    }
+    pool.wait();
+}
+
+void render(ThreadPool& pool) {
+    if (wavefront) {
+        renderWavefront(pool);
+        return;
+    }
+    View view = makeView();
+    renderTiles(pool, [&](int x0, int y0, int x1, int y1) {
+        renderTile(x0, y0, x1, y1, view);
+    });
+}
+
+void prefetchWorld() {
+    if (world == nullptr || world->getStream() == nullptr) {
+        return;
+    }
+    View view = makeView();
+    // The cone around the view direction through the image corners
+    float halfAngle = std::atan(view.tanHalfFov * std::sqrt(1.0f + view.aspectRatio * view.aspectRatio));
+    world->prefetch(view.position, view.direction, halfAngle, PREFETCH_DISTANCE);
+}
+
+
+ProgressiveRenderer::ProgressiveRenderer(int maxSamples) : maxSamples(maxSamples) {}
+
+void ProgressiveRenderer::restart(ThreadPool& pool) {
+    cancelled = true;
+    pool.wait();
+    cancelled = false;
+    running = false;
+    pass = 0;
+}
+
+bool ProgressiveRenderer::finishPass(ThreadPool& pool) {
+    if (!running || !pool.idle()) {
+        return false;
+    }
+    running = false;
+    return true;
+}
+
+void ProgressiveRenderer::startPass(ThreadPool& pool) {
+    if (running || converged()) {
+        return;
+    }
+    if (accumulation.size() != static_cast<size_t>(screenWidth) * screenHeight) {
+        accumulation.assign(static_cast<size_t>(screenWidth) * screenHeight, Radiance(0.0f));
+    }
+
+    View view = makeView();
+    int currentPass = pass++;
+    running = true;
+    for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+        for (int x0 = 0; x0 < screenWidth; x0 += TILE_SIZE) {
+            int x1 = std::min(x0 + TILE_SIZE, screenWidth);
+            int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+            pool.submit([=, this] {
+                if (cancelled) {
+                    return;
+                }
+                if (currentPass < PREVIEW_PASSES) {
+                    previewTile(x0, y0, x1, y1, view, PREVIEW_BLOCK >> currentPass);
+                } else {
+                    accumulateTile(x0, y0, x1, y1, view, currentPass - PREVIEW_PASSES);
+                }
+                framebuffer.resolve(x0, y0, x1, y1, tonemap, exposure);
+                finishTile();
+            });
+        }
+    }
+}
+
+int ProgressiveRenderer::samples() const {
+    return std::max(0, pass - (running ? 1 : 0) - PREVIEW_PASSES);
+}
+
+void ProgressiveRenderer::previewTile(int x0, int y0, int x1, int y1, const View& view, int block) const {
+    // The cone covers the whole block, so textures are read at a matching mip level
+    RayCone cone{0.0f, view.pixelCone.spreadAngle * block};
+    for (int by = y0; by < y1; by += block) {
+        for (int bx = x0; bx < x1; bx += block) {
+            int bx1 = std::min(bx + block, x1);
+            int by1 = std::min(by + block, y1);
+            glm::vec3 rayDirection = primaryRayDirection(view, bx, by, (bx1 - bx) * 0.5f, (by1 - by) * 0.5f);
+            Radiance color = castRay(view.position, rayDirection, 0, cone);
+            for (int y = by; y < by1; y++) {
+                for (int x = bx; x < bx1; x++) {
+                    framebuffer.setRadiance(x, y, color);
+                }
+            }
+        }
+    }
+}
+
+void ProgressiveRenderer::accumulateTile(int x0, int y0, int x1, int y1, const View& view, int sample) {
+    Radiance colors[TILE_SIZE * TILE_SIZE];
+    float offsetX, offsetY;
+    jitterOffset(sample, offsetX, offsetY);
+    traceTileSample(x0, y0, x1, y1, view, offsetX, offsetY, colors);
+
+    int tileWidth = x1 - x0;
+    float weight = 1.0f / (sample + 1);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            Radiance& sum = accumulation[static_cast<size_t>(y) * screenWidth + x];
+            // The first full-resolution sample replaces whatever the last view left
+            sum = sample == 0 ? colors[(y - y0) * tileWidth + (x - x0)] : sum + colors[(y - y0) * tileWidth + (x - x0)];
+            framebuffer.setRadiance(x, y, sum * weight);
+        }
+    }
+}
+
+
+// Pixel that a ray from the camera along `direction` passes through; false when the
+// ray leaves the screen or points behind the camera. depth is the distance along the
+// view direction per unit of `direction`.
+inline bool projectToPixel(const View& view, const glm::vec3& direction, float& depth, int& x, int& y) {
+    depth = glm::dot(direction, view.direction);
+    if (depth <= 0.0f) {
+        return false;
+    }
+    float screenX = glm::dot(direction, view.right) / (depth * view.tanHalfFov * view.aspectRatio);
+    float screenY = glm::dot(direction, view.up) / (depth * view.tanHalfFov);
+    float px = (screenX + 1.0f) * 0.5f * screenWidth;
+    float py = (1.0f - screenY) * 0.5f * screenHeight;
+    if (!(px >= 0.0f && px < screenWidth && py >= 0.0f && py < screenHeight)) {
+        return false;
+    }
+    x = static_cast<int>(px);
+    y = static_cast<int>(py);
+    return true;
+}
+
+void ReprojectionCache::render(ThreadPool& pool) {
+    View view = makeView();
+    size_t pixelCount = static_cast<size_t>(screenWidth) * screenHeight;
+    if (points.size() != pixelCount) {
+        points.assign(pixelCount, SamplePoint());
+        shadings.assign(pixelCount, Shading());
+        previousPoints.assign(pixelCount, SamplePoint());
+        previousShadings.assign(pixelCount, Shading());
+        nearest = std::make_unique<std::atomic<unsigned long long>[]>(pixelCount);
+        valid = false;
+    }
+    std::swap(points, previousPoints);
+    std::swap(shadings, previousShadings);
+    reusedPixels = 0;
+
+    if (valid) {
+        for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+            int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+            pool.submit([=, this] {
+                for (size_t i = static_cast<size_t>(y0) * screenWidth; i < static_cast<size_t>(y1) * screenWidth; i++) {
+                    nearest[i].store(NO_SAMPLE, std::memory_order_relaxed);
+                }
+            });
+        }
+        pool.wait();
+        for (int y0 = 0; y0 < screenHeight; y0 += TILE_SIZE) {
+            int y1 = std::min(y0 + TILE_SIZE, screenHeight);
+            pool.submit([=, this] {
+                scatter(y0, y1, view);
+            });
+        }
+        pool.wait();
+    }
+
+    renderTiles(pool, [&](int x0, int y0, int x1, int y1) {
+        renderTile(x0, y0, x1, y1, view);
+    });
+    valid = true;
+}
+
+float ReprojectionCache::reusedFraction() const {
+    return points.empty() ? 0.0f : static_cast<float>(reusedPixels) / static_cast<float>(points.size());
+}
+
+// Projects the previous frame's samples from rows [y0, y1) into this frame; where
+// several land on one pixel the nearest wins
+void ReprojectionCache::scatter(int y0, int y1, const View& view) {
+    for (size_t i = static_cast<size_t>(y0) * screenWidth; i < static_cast<size_t>(y1) * screenWidth; i++) {
+        const SamplePoint& point = previousPoints[i];
+        glm::vec3 direction = point.id == SKY ? point.position : point.position - view.position;
+        float depth;
+        int x, y;
+        if (!projectToPixel(view, direction, depth, x, y)) {
+            continue;
+        }
+        // Positive floats order like their bit patterns; the sky is infinitely far
+        Uint32 depthBits = point.id == SKY ? 0x7F800000u : std::bit_cast<Uint32>(depth);
+        unsigned long long key = static_cast<unsigned long long>(depthBits) << 32 | i;
+        std::atomic<unsigned long long>& slot = nearest[static_cast<size_t>(y) * screenWidth + x];
+        unsigned long long current = slot.load(std::memory_order_relaxed);
+        while (key < current && !slot.compare_exchange_weak(current, key, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+// A pixel reuses its reprojected sample unless it got none, or a neighbour's sample is
+// clearly nearer and from another surface: then this one was likely hidden behind it
+bool ReprojectionCache::reusable(int x, int y) const {
+    unsigned long long key = nearest[static_cast<size_t>(y) * screenWidth + x].load(std::memory_order_relaxed);
+    if (key == NO_SAMPLE) {
+        return false;
+    }
+    float depth = std::bit_cast<float>(static_cast<Uint32>(key >> 32));
+    int id = previousPoints[key & 0xFFFFFFFFu].id;
+    for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, screenHeight - 1); ny++) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, screenWidth - 1); nx++) {
+            unsigned long long neighbour = nearest[static_cast<size_t>(ny) * screenWidth + nx].load(std::memory_order_relaxed);
+            if (neighbour == NO_SAMPLE) {
+                continue;
+            }
+            float neighbourDepth = std::bit_cast<float>(static_cast<Uint32>(neighbour >> 32));
+            if (neighbourDepth < depth * 0.95f && previousPoints[neighbour & 0xFFFFFFFFu].id != id) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Reused pixels are shaded at once; the others are gathered in scanline order, as in
+// AdaptiveSampler::refineTile(), and traced a packet at a time
+void ReprojectionCache::renderTile(int x0, int y0, int x1, int y1, const View& view) {
+    const PacketKernels& kernels = packetKernels != nullptr ? *packetKernels : *scalarPacketKernels();
+    int traced[TILE_SIZE * TILE_SIZE];
+    int tracedCount = 0;
+    size_t reused = 0;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            if (!valid || !reusable(x, y)) {
+                traced[tracedCount++] = (y - y0) * TILE_SIZE + (x - x0);
+                continue;
+            }
+            size_t index = static_cast<size_t>(y) * screenWidth + x;
+            size_t source = nearest[index].load(std::memory_order_relaxed) & 0xFFFFFFFFu;
+            points[index] = previousPoints[source];
+            Radiance color;
+            if (points[index].id == SKY) {
+                // Still sky here: look up this pixel's own direction
+                color = skybox->getColor(primaryRayDirection(view, x, y, 0.5f, 0.5f), view.pixelCone.spreadAngle);
+            } else {
+                shadings[index] = previousShadings[source];
+                color = reuseSample(view, points[index], shadings[index]);
+            }
+            framebuffer.setRadiance(x, y, color);
+            reused++;
+        }
+    }
+
+    for (int first = 0; first < tracedCount; first += kernels.width) {
+        traceSamples(traced + first, std::min(kernels.width, tracedCount - first), x0, y0, view, kernels);
+    }
+    reusedPixels += reused;
+    finishTile();
+}
+
+// Traces the pixel centers of up to a packet of pixels (offsets in the tile at x0, y0),
+// primary and shadow rays as packets, and fills their samples and colors
+void ReprojectionCache::traceSamples(const int* pixels, int laneCount, int x0, int y0, const View& view, const PacketKernels& kernels) {
+    RayPacket primary;
+    for (int lane = 0; lane < laneCount; lane++) {
+        primary.setRay(lane, view.position, primaryRayDirection(view, x0 + pixels[lane] % TILE_SIZE, y0 + pixels[lane] / TILE_SIZE, 0.5f, 0.5f));
+    }
+    SceneHit hits[RayPacket::MAX_WIDTH];
+    const Material* hitMaterials[RayPacket::MAX_WIDTH] = {};
+    const glm::mat3* normalMatrices[RayPacket::MAX_WIDTH] = {};
+    glm::vec3 directions[RayPacket::MAX_WIDTH];
+    traceRayPacket(primary, view, kernels, hits, hitMaterials, normalMatrices, directions);
+
+    glm::vec3 lightDirs[RayPacket::MAX_WIDTH];
+    RayPacket shadow;
+    for (int lane = 0; lane < laneCount; lane++) {
+        if (hits[lane].intersect.isIntersecting) {
+            lightDirs[lane] = lightDirection(hits[lane].intersect, normalMatrices[lane]);
+            setShadowRay(shadow, lane, hits[lane], lightDirs[lane]);
+        }
+    }
+    startShadowQuery();
+    unsigned int occluded = shadow.activeMask != 0 ? scene.anyHitPacket(shadow, kernels, lastOccluder.primitive) : 0;
+    tileRays.shadow += std::popcount(shadow.activeMask);
+
+    for (int lane = 0; lane < laneCount; lane++) {
+        int x = x0 + pixels[lane] % TILE_SIZE;
+        int y = y0 + pixels[lane] / TILE_SIZE;
+        size_t index = static_cast<size_t>(y) * screenWidth + x;
+        SamplePoint& point = points[index];
+        const Intersect& intersect = hits[lane].intersect;
+        if (!intersect.isIntersecting) {
+            point.id = SKY;
+            point.position = directions[lane];
+            framebuffer.setRadiance(x, y, skybox->getColor(directions[lane], view.pixelCone.spreadAngle));
+            continue;
+        }
+
+        const Material& material = *hitMaterials[lane];
+        float shadowIntensity = packetShadow(shadow, occluded, lane, intersect.point, lightDirs[lane]);
+        RayCone cone = view.pixelCone.bounce(intersect.dist);
+        Shading& shading = shadings[index];
+        point.position = intersect.point;
+        point.id = surfaceId(hits[lane]);
+        shading.normal = intersect.normal;
+        shading.shadowIntensity = shadowIntensity;
+        shading.material = &material;
+        shading.normalMatrix = normalMatrices[lane];
+        shading.diffuse = diffuseLight(directions[lane], intersect, material, lightDirs[lane], shadowIntensity, cone);
+        framebuffer.setRadiance(x, y, shading.diffuse * localWeight(material) +
+                                      viewDependentLight(view.position, directions[lane], intersect, material, normalMatrices[lane],
+                                                         lightDirs[lane], shadowIntensity, cone));
+    }
+}
+
+// Cached diffuse light plus the view-dependent terms recomputed from the new camera position
+Radiance ReprojectionCache::reuseSample(const View& view, const SamplePoint& point, const Shading& shading) const {
+    Intersect intersect;
+    intersect.isIntersecting = true;
+    intersect.point = point.position;
+    intersect.normal = shading.normal;
+    intersect.dist = glm::length(point.position - view.position);
+    glm::vec3 rayDirection = (point.position - view.position) / intersect.dist;
+
+    glm::vec3 lightDir = lightDirection(intersect, shading.normalMatrix);
+    return shading.diffuse * localWeight(*shading.material) +
+           viewDependentLight(view.position, rayDirection, intersect, *shading.material, shading.normalMatrix, lightDir,
+                              shading.shadowIntensity, view.pixelCone.bounce(intersect.dist));
+}
+
+
+void GBuffer::render(ThreadPool& pool) {
+    texels.resize(static_cast<size_t>(screenWidth) * screenHeight);
+    View view = makeView();
+    renderTiles(pool, [&](int x0, int y0, int x1, int y1) {
+        shadeTile(x0, y0, x1, y1, view, true);
+    });
+}
+
+void GBuffer::relight(ThreadPool& pool) {
+    View view = makeView();
+    renderTiles(pool, [&](int x0, int y0, int x1, int y1) {
+        shadeTile(x0, y0, x1, y1, view, false);
+    });
+}
+
+// Packets are laid out as in traceTilePackets(); without packet kernels the scalar ones
+// keep the grouping
+void GBuffer::shadeTile(int x0, int y0, int x1, int y1, const View& view, bool trace) {
+    const PacketKernels& kernels = packetKernels != nullptr ? *packetKernels : *scalarPacketKernels();
+    const int packetWidth = kernels.width / 2;
+    const int packetHeight = 2;
+
+    for (int y = y0; y < y1; y += packetHeight) {
+        for (int x = x0; x < x1; x += packetWidth) {
+            SceneHit hits[RayPacket::MAX_WIDTH];
+            const Material* hitMaterials[RayPacket::MAX_WIDTH] = {};
+            const glm::mat3* normalMatrices[RayPacket::MAX_WIDTH] = {};
+            glm::vec3 directions[RayPacket::MAX_WIDTH];
+            unsigned int activeMask = 0;
+
+            if (trace) {
+                activeMask = tracePrimaryPacket(x, y, x1, y1, view, 0.5f, 0.5f, kernels, hits, hitMaterials, normalMatrices, directions);
+                for (int lane = 0; lane < kernels.width; lane++) {
+                    if (activeMask & (1u << lane)) {
+                        size_t index = static_cast<size_t>(y + lane / packetWidth) * screenWidth + x + lane % packetWidth;
+                        texels[index] = Texel{hits[lane].intersect, directions[lane], hits[lane].primitive, hits[lane].materialId};
+                    }
+                }
+            } else {
+                for (int lane = 0; lane < kernels.width; lane++) {
+                    int px = x + lane % packetWidth;
+                    int py = y + lane / packetWidth;
+                    if (px >= x1 || py >= y1) {
+                        continue;
+                    }
+                    activeMask |= 1u << lane;
+                    const Texel& texel = texels[static_cast<size_t>(py) * screenWidth + px];
+                    hits[lane].intersect = texel.intersect;
+                    hits[lane].primitive = texel.primitive;
+                    directions[lane] = texel.direction;
+                    if (texel.intersect.isIntersecting) {
+                        hitMaterials[lane] = texel.materialId >= 0 ? &scene.getMaterial(texel.materialId)
+                                                                   : &world->getMaterial(static_cast<Uint8>(-1 - texel.materialId));
+                        normalMatrices[lane] = texel.primitive >= 0 ? scene.getNormalMatrix(texel.primitive) : nullptr;
+                    }
+                }
+            }
+
+            Radiance laneColors[RayPacket::MAX_WIDTH];
+            shadePrimaryHits(view.position, directions, hits, hitMaterials, normalMatrices, activeMask, view.pixelCone,
+                             kernels, laneColors);
+            for (int lane = 0; lane < kernels.width; lane++) {
+                if (activeMask & (1u << lane)) {
+                    framebuffer.setRadiance(x + lane % packetWidth, y + lane / packetWidth, laneColors[lane]);
+                }
+            }
+        }
+    }
+    finishTile();
+}
+
+
+AdaptiveSampler::AdaptiveSampler(int maxSamples, float threshold) : maxSamples(maxSamples), threshold(threshold) {}
+
+void AdaptiveSampler::render(ThreadPool& pool) {
+    texels.resize(static_cast<size_t>(screenWidth) * screenHeight);
+    refinedPixels = 0;
+    View view = makeView();
+    // Every center first, so that tiles see their neighbours' across the seams
+    forEachTile(pool, [&](int x0, int y0, int x1, int y1) {
+        traceTile(x0, y0, x1, y1, view);
+    });
+    renderTiles(pool, [&](int x0, int y0, int x1, int y1) {
+        refineTile(x0, y0, x1, y1, view);
+    });
+}
+
+float AdaptiveSampler::averageSamples() const {
+    return 1.0f + (maxSamples - 1) * refinedFraction();
+}
+
+float AdaptiveSampler::refinedFraction() const {
+    return texels.empty() ? 0.0f : static_cast<float>(refinedPixels) / static_cast<float>(texels.size());
+}
+
+// Pixel centers in the packets of traceTilePackets()
+void AdaptiveSampler::traceTile(int x0, int y0, int x1, int y1, const View& view) {
+    const PacketKernels& kernels = packetKernels != nullptr ? *packetKernels : *scalarPacketKernels();
+    const int packetWidth = kernels.width / 2;
+    const int packetHeight = 2;
+
+    for (int y = y0; y < y1; y += packetHeight) {
+        for (int x = x0; x < x1; x += packetWidth) {
+            SceneHit hits[RayPacket::MAX_WIDTH];
+            const Material* hitMaterials[RayPacket::MAX_WIDTH] = {};
+            const glm::mat3* normalMatrices[RayPacket::MAX_WIDTH] = {};
+            glm::vec3 directions[RayPacket::MAX_WIDTH];
+            unsigned int activeMask = tracePrimaryPacket(x, y, x1, y1, view, 0.5f, 0.5f, kernels, hits, hitMaterials,
+                                                         normalMatrices, directions);
+
+            Radiance laneColors[RayPacket::MAX_WIDTH];
+            shadePrimaryHits(view.position, directions, hits, hitMaterials, normalMatrices, activeMask, view.pixelCone,
+                             kernels, laneColors);
+            for (int lane = 0; lane < kernels.width; lane++) {
+                if (activeMask & (1u << lane)) {
+                    const Intersect& intersect = hits[lane].intersect;
+                    size_t index = static_cast<size_t>(y + lane / packetWidth) * screenWidth + x + lane % packetWidth;
+                    texels[index] = Texel{laneColors[lane], intersect.isIntersecting ? intersect.dist : std::numeric_limits<float>::infinity(),
+                                          surfaceId(hits[lane])};
+                }
+            }
+        }
+    }
+    finishTile();
+}
+
+// The pixels to refine are gathered in scanline order, so along an edge a packet's
+// lanes are mostly neighbours; each packet traces one sample index for its pixels.
+void AdaptiveSampler::refineTile(int x0, int y0, int x1, int y1, const View& view) {
+    const PacketKernels& kernels = packetKernels != nullptr ? *packetKernels : *scalarPacketKernels();
+    int refined[TILE_SIZE * TILE_SIZE];
+    Radiance sums[TILE_SIZE * TILE_SIZE];
+    int refinedCount = 0;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            Radiance color = texels[static_cast<size_t>(y) * screenWidth + x].color;
+            if (maxSamples > 1 && needsSamples(x, y)) {
+                sums[refinedCount] = color;
+                refined[refinedCount++] = (y - y0) * TILE_SIZE + (x - x0);
+            } else {
+                framebuffer.setRadiance(x, y, color);
+            }
+        }
+    }
+
+    for (int first = 0; first < refinedCount; first += kernels.width) {
+        int laneCount = std::min(kernels.width, refinedCount - first);
+        for (int sample = 1; sample < maxSamples; sample++) {
+            float offsetX, offsetY;
+            jitterOffset(sample, offsetX, offsetY);
+            RayPacket primary;
+            for (int lane = 0; lane < laneCount; lane++) {
+                int pixel = refined[first + lane];
+                primary.setRay(lane, view.position, primaryRayDirection(view, x0 + pixel % TILE_SIZE, y0 + pixel / TILE_SIZE, offsetX, offsetY));
+            }
+
+            SceneHit hits[RayPacket::MAX_WIDTH];
+            const Material* hitMaterials[RayPacket::MAX_WIDTH] = {};
+            const glm::mat3* normalMatrices[RayPacket::MAX_WIDTH] = {};
+            glm::vec3 directions[RayPacket::MAX_WIDTH];
+            unsigned int activeMask = traceRayPacket(primary, view, kernels, hits, hitMaterials, normalMatrices, directions);
+            Radiance laneColors[RayPacket::MAX_WIDTH];
+            shadePrimaryHits(view.position, directions, hits, hitMaterials, normalMatrices, activeMask, view.pixelCone,
+                             kernels, laneColors);
+            for (int lane = 0; lane < laneCount; lane++) {
+                sums[first + lane] += laneColors[lane];
+            }
+        }
+    }
+
+    float weight = 1.0f / maxSamples;
+    for (int i = 0; i < refinedCount; i++) {
+        framebuffer.setRadiance(x0 + refined[i] % TILE_SIZE, y0 + refined[i] / TILE_SIZE, sums[i] * weight);
+    }
+    refinedPixels += refinedCount;
+    finishTile();
+}
+
+// Radiance clamped to 1 under a square root, close enough to sRGB encoding that dark
+// edges count as much as bright ones
+inline glm::vec3 perceivedColor(const Radiance& radiance) {
+    return glm::vec3(std::sqrt(std::min(radiance.x, 1.0f)), std::sqrt(std::min(radiance.y, 1.0f)), std::sqrt(std::min(radiance.z, 1.0f)));
+}
+
+bool AdaptiveSampler::needsSamples(int x, int y) const {
+    const Texel& center = texels[static_cast<size_t>(y) * screenWidth + x];
+    glm::vec3 centerColor = perceivedColor(center.color);
+    for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, screenHeight - 1); ny++) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, screenWidth - 1); nx++) {
+            const Texel& neighbour = texels[static_cast<size_t>(ny) * screenWidth + nx];
+            if (neighbour.id != center.id) {
+                return true;
+            }
+            // Equal IDs are both sky or both finite
+            if (center.id != -1 && std::abs(neighbour.depth - center.depth) > DEPTH_RATIO * std::min(neighbour.depth, center.depth)) {
+                return true;
+            }
+            glm::vec3 difference = glm::abs(perceivedColor(neighbour.color) - centerColor);
+            if (std::max(difference.x, std::max(difference.y, difference.z)) > threshold) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "color.h"
+#include "object.h"
+#include "light.h"
+#include "lighttree.h"
+#include "camera.h"
+#include "skybox.h"
+#include "framebuffer.h"
+#include "scene.h"
+#include "voxelworld.h"
+#include "packet.h"
+#include "ray.h"
+#include "threadpool.h"
+
+// Upper bound for maxDepth; sizes the per-ray stack of pending secondary rays
+const int MAX_DEPTH_LIMIT = 64;
+// With rayCulling, reflected and refracted rays below MIN_RAY_WEIGHT of the pixel are
+// dropped, and from ROULETTE_DEPTH on, rays below ROULETTE_WEIGHT play Russian roulette
+const float MIN_RAY_WEIGHT = 1.0f / 1024.0f;
+const int ROULETTE_DEPTH = 3;
+const float ROULETTE_WEIGHT = 0.1f;
+const float BIAS = 0.0001f;
+const int TILE_SIZE = 32;
+// Distance in cells within which prefetchWorld() loads a streamed world's chunks
+const float PREFETCH_DISTANCE = 256.0f;
+
+// Render settings; main() sets them from RenderOptions
+extern int screenWidth;
+extern int screenHeight;
+extern float fieldOfView;
+extern int samplesPerPixel;
+// Bounces a path may take, up to MAX_DEPTH_LIMIT; rays at this depth aren't traced and
+// see the sky, so 1 shades primary hits and their reflections and refractions show the sky
+extern int maxDepth;
+// Drops reflected and refracted rays of negligible weight, see MIN_RAY_WEIGHT
+extern bool rayCulling;
+// render() runs stage by stage over batches of rays instead of pixel by pixel
+extern bool wavefront;
+// Shadow rays test the last occluder of their thread first. Which occluder a shadowed
+// point reports, and so its distance-based attenuation, can then differ slightly.
+extern bool occluderCache;
+// Lights picked from `lights` per shading point, each with one shadow ray; 0 takes every light
+extern int lightSamples;
+// Bilinear texture filtering instead of nearest texel
+extern bool bilinearTextures;
+// Textures and the skybox are sampled at the mip level matching each ray's footprint
+extern bool mipmapping;
+// Applied to the linear radiance of every frame before sRGB encoding
+extern Tonemap tonemap;
+extern float exposure;
+extern unsigned int threadCount;
+
+// What gets rendered. scene is the flattened copy of objects; build it again after changing them.
+extern std::vector<Object*> objects;
+extern Scene scene;
+extern VoxelWorld* world;
+extern Framebuffer framebuffer;
+extern Light light;
+// Point, area and emissive block lights besides the key light; their light is diffuse only
+extern LightTree lights;
+extern Camera camera;
+extern Skybox* skybox;
+
+// Packet kernels for primary and shadow rays; nullptr traces every ray on its own
+extern const PacketKernels* packetKernels;
+
+// Traces the ray and its reflections and refractions off an explicit stack; depth is the
+// bounce the ray starts at. cone is the ray's footprint, used to pick texture mip levels;
+// the default samples full resolution.
+Radiance castRay(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, int depth = 0, const RayCone& cone = RayCone());
+
+// Splits the frame into TILE_SIZE tiles and traces them on the pool. With wavefront set,
+// each band of TILE_SIZE rows instead goes through the stages one batch at a time:
+// primary rays are generated into a buffer, intersected in packets, their shadow rays
+// traced in packets, the hits shaded grouped by material, and the reflected and
+// refracted rays sorted by direction octant into the next batch.
+void render(ThreadPool& pool);
+
+// Has a streamed world load the chunks in front of the camera ahead of the next
+// frame's rays; call after moving the camera. Does nothing for worlds held in memory.
+void prefetchWorld();
+
+// Rays traced by render() since the last resetRayStats(), over all threads.
+// Secondary rays are reflections and refractions.
+struct RayStats {
+    unsigned long long primary = 0;
+    unsigned long long secondary = 0;
+    unsigned long long shadow = 0;
+
+    unsigned long long total() const { return primary + secondary + shadow; }
+};
+
+RayStats rayStats();
+void resetRayStats();
+
+// Time spent in each wavefront stage since the last resetWavefrontStats(), summed over threads
+struct WavefrontStats {
+    double generateMs = 0.0;
+    double intersectMs = 0.0;
+    double shadowMs = 0.0;
+    double sortMs = 0.0;
+    double shadeMs = 0.0;
+};
+
+WavefrontStats wavefrontStats();
+void resetWavefrontStats();
+
+// Camera basis of one pass, defined in renderer.cpp
+struct View;
+
+// Interactive rendering in passes that never block the caller: blocky previews at
+// 1/8, 1/4 and 1/2 resolution, then jittered full-resolution samples averaged in an
+// accumulation buffer until maxSamples. A pass runs on the pool while the caller
+// keeps handling input; restart() cancels it within one tile's time.
+class ProgressiveRenderer {
+public:
+    explicit ProgressiveRenderer(int maxSamples = 64);
+
+    // Cancels the running pass and starts over from the coarsest preview; call
+    // whenever the camera or the scene changed
+    void restart(ThreadPool& pool);
+
+    // Starts the next pass unless one is running or the image has converged
+    void startPass(ThreadPool& pool);
+
+    // True once, when the running pass has finished and framebuffer holds its result
+    bool finishPass(ThreadPool& pool);
+
+    bool converged() const { return pass >= PREVIEW_PASSES + maxSamples; }
+    // Full-resolution samples in the framebuffer; 0 while previews are shown
+    int samples() const;
+
+private:
+    static const int PREVIEW_PASSES = 3;
+    // Block side of the first preview, halved by each later one
+    static const int PREVIEW_BLOCK = 8;
+
+    void previewTile(int x0, int y0, int x1, int y1, const View& view, int block) const;
+    void accumulateTile(int x0, int y0, int x1, int y1, const View& view, int sample);
+
+    int maxSamples;
+    int pass = 0;
+    bool running = false;
+    std::atomic<bool> cancelled{false};
+    std::vector<Radiance> accumulation;
+};
+
+// Reuses the last frame's shading after small camera moves. Each pixel keeps the point
+// its primary ray hit, what it hit and the diffuse light there, which doesn't depend on
+// the view. The next frame projects those points into its own pixels: a pixel that
+// receives one recomputes only specular, reflection and refraction for the new view.
+// Pixels that receive none (disoccluded or new at the border), or whose point sits next
+// to a nearer, different surface that may now hide it, are traced in full.
+//
+// One sample per pixel at its center; cached points land up to a pixel off their
+// original spot, so a still view should get one full render() afterwards.
+class ReprojectionCache {
+public:
+    // Renders the camera's view into framebuffer, reprojecting the previous call's frame
+    // unless the cache was invalidated, and keeps this frame for the next call
+    void render(ThreadPool& pool);
+
+    // Call when anything but the camera changed (light, materials, objects, resolution);
+    // the next render() traces every pixel
+    void invalidate() { valid = false; }
+
+    // Share of the last render()'s pixels that reused cached shading
+    float reusedFraction() const;
+
+private:
+    // Split from Shading so reprojection only streams 16 bytes per pixel
+    struct SamplePoint {
+        // Hit point, or the ray direction for sky samples
+        glm::vec3 position;
+        // Primitive index, a voxel cell's hash below -2, or SKY
+        int id;
+    };
+
+    // Unused for sky samples
+    struct Shading {
+        glm::vec3 normal;
+        float shadowIntensity;
+        const Material* material;
+        const glm::mat3* normalMatrix;
+        // Before localWeight()
+        Radiance diffuse;
+    };
+
+    static const int SKY = -1;
+    static const unsigned long long NO_SAMPLE = ~0ull;
+
+    void scatter(int y0, int y1, const View& view);
+    void renderTile(int x0, int y0, int x1, int y1, const View& view);
+    bool reusable(int x, int y) const;
+    void traceSamples(const int* pixels, int laneCount, int x0, int y0, const View& view, const PacketKernels& kernels);
+    Radiance reuseSample(const View& view, const SamplePoint& point, const Shading& shading) const;
+
+    bool valid = false;
+    // This frame's samples, and the previous frame's being reprojected
+    std::vector<SamplePoint> points;
+    std::vector<Shading> shadings;
+    std::vector<SamplePoint> previousPoints;
+    std::vector<Shading> previousShadings;
+    // Per pixel: nearest reprojected previous sample as depth bits << 32 | index
+    std::unique_ptr<std::atomic<unsigned long long>[]> nearest;
+    std::atomic<size_t> reusedPixels{0};
+};
+
+// Primary hits of one view, kept so that a change of light or materials can be shaded
+// again without intersecting the primary rays. render() traces the pixel centers and
+// stores their hits; relight() reruns only shadow rays, shading and secondary rays.
+// Both group pixels into the same packets, so relight() gives exactly the image
+// render() would. Materials are looked up by ID, so Scene::setMaterial() and
+// VoxelWorld::setMaterial() edits show up.
+class GBuffer {
+public:
+    // Traces, stores and shades the camera's view into framebuffer
+    void render(ThreadPool& pool);
+
+    // Shades the stored hits with the current light and materials into framebuffer. The
+    // camera, resolution, objects and world must be those of the last render().
+    void relight(ThreadPool& pool);
+
+    size_t memoryFootprint() const { return sizeof(GBuffer) + texels.capacity() * sizeof(Texel); }
+
+private:
+    struct Texel {
+        Intersect intersect;
+        glm::vec3 direction;
+        // -1 for a voxel block or a miss
+        int primitive;
+        // Scene material index, or -1 - block ID for voxel blocks
+        int materialId;
+    };
+
+    void shadeTile(int x0, int y0, int x1, int y1, const View& view, bool trace);
+
+    std::vector<Texel> texels;
+};
+
+// Supersampling spent where the image needs it. render() first traces every pixel
+// center and keeps its color, what its primary ray hit and how far away. A pixel that
+// hit something else than one of its 8 neighbours, lies more than DEPTH_RATIO nearer
+// or farther, or differs from it by more than threshold in any channel (of the square
+// root of radiance clamped to 1, roughly sRGB) then traces maxSamples - 1 jittered
+// samples more, in packets, averaged with the center. Flat areas keep one sample;
+// silhouettes and shadow, texture and voxel edges get maxSamples.
+class AdaptiveSampler {
+public:
+    explicit AdaptiveSampler(int maxSamples = 8, float threshold = 0.1f);
+
+    void render(ThreadPool& pool);
+
+    // Over the last render(): samples traced per pixel, and the share of pixels refined
+    float averageSamples() const;
+    float refinedFraction() const;
+
+    size_t memoryFootprint() const { return sizeof(AdaptiveSampler) + texels.capacity() * sizeof(Texel); }
+
+private:
+    struct Texel {
+        Radiance color;
+        // Hit distance, infinite for the sky
+        float depth;
+        int id;
+    };
+
+    static constexpr float DEPTH_RATIO = 0.1f;
+
+    void traceTile(int x0, int y0, int x1, int y1, const View& view);
+    void refineTile(int x0, int y0, int x1, int y1, const View& view);
+    bool needsSamples(int x, int y) const;
+
+    int maxSamples;
+    float threshold;
+    std::vector<Texel> texels;
+    std::atomic<size_t> refinedPixels{0};
+};
@@ -0,0 +1,101 @@
+#include "renderthread.h"
+#include <cstring>
+
+RenderThread::RenderThread(ThreadPool& pool, bool progressive, int maxSamples, bool reprojection)
+        : pool(pool), progressiveMode(progressive), progressive(maxSamples), reprojectionMode(reprojection) {
+    for (RenderedFrame& frame : frames) {
+        frame.pixels.assign(static_cast<size_t>(framebuffer.width) * framebuffer.height, 0xFF000000);
+    }
+    thread = std::thread([this] { run(); });
+}
+
+RenderThread::~RenderThread() {
+    stopping = true;
+    thread.join();
+}
+
+const RenderedFrame* RenderThread::acquireFrame() {
+    if (!(middle.load(std::memory_order_acquire) & FRESH)) {
+        return nullptr;
+    }
+    frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+    return &frames[frontIndex];
+}
+
+void RenderThread::publish(bool showsNewInput, std::chrono::steady_clock::time_point inputIssued, int samples) {
+    RenderedFrame& frame = frames[backIndex];
+    std::memcpy(frame.pixels.data(), framebuffer.data(), frame.pixels.size() * sizeof(Uint32));
+    frame.showsNewInput = showsNewInput;
+    frame.inputIssued = inputIssued;
+    frame.samples = samples;
+    backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    renderedCount++;
+}
+
+void RenderThread::run() {
+    // Issue time of the oldest input no published frame shows yet
+    bool inputPending = false;
+    std::chrono::steady_clock::time_point pendingInput;
+    bool cameraChanged = true;
+    // The frame on screen was reprojected and should be traced again once the camera rests
+    bool reprojected = false;
+
+    while (!stopping) {
+        CameraCommand command;
+        while (commands.pop(command)) {
+            if (command.type == CameraCommand::Move) {
+                camera.move(command.amount);
+            } else {
+                camera.rotate(command.amount, command.amountY);
+            }
+            if (!inputPending) {
+                inputPending = true;
+                pendingInput = command.issued;
+            }
+            cameraChanged = true;
+        }
+
+        if (cameraChanged) {
+            prefetchWorld();
+        }
+
+        bool published = false;
+        if (progressiveMode) {
+            if (cameraChanged) {
+                progressive.restart(pool);
+            }
+            // After a restart, the next pass to finish is the first one from the new camera
+            if (progressive.finishPass(pool)) {
+                publish(inputPending, pendingInput, progressive.samples());
+                inputPending = false;
+                published = true;
+            }
+            progressive.startPass(pool);
+        } else if (cameraChanged) {
+            if (reprojectionMode) {
+                reprojection.render(pool);
+                // Nothing to refine when the cache was empty and every pixel was traced
+                reprojected = reprojection.reusedFraction() > 0.0f;
+            } else {
+                render(pool);
+            }
+            publish(inputPending, pendingInput, samplesPerPixel);
+            inputPending = false;
+            published = true;
+        } else if (reprojected) {
+            reprojection.invalidate();
+            reprojection.render(pool);
+            reprojected = false;
+            publish(false, pendingInput, samplesPerPixel);
+            published = true;
+        }
+        cameraChanged = false;
+
+        if (!published) {
+            // A pass is running on the pool, or the view has converged
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    progressive.restart(pool);
+}
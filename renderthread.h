@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "renderer.h"
+
+// Camera change sent from the event loop to the render thread
+struct CameraCommand {
+    enum Type {
+        Move,
+        Rotate
+    };
+
+    Type type;
+    // Move: distance along the view direction. Rotate: horizontal angle.
+    float amount;
+    // Rotate: vertical angle
+    float amountY;
+    std::chrono::steady_clock::time_point issued;
+};
+
+// Bounded ring buffer for one producer and one consumer thread. push() and pop()
+// never lock or block; each side only writes its own index.
+template<typename T, size_t Capacity>
+class SpscQueue {
+public:
+    // False when the queue is full
+    bool push(const T& value) {
+        size_t tail = writeIndex.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % Capacity;
+        if (next == readIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        items[tail] = value;
+        writeIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // False when the queue is empty
+    bool pop(T& value) {
+        size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = items[head];
+        readIndex.store((head + 1) % Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items;
+    // On separate cache lines so the two threads don't share one
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) std::atomic<size_t> readIndex{0};
+};
+
+// A finished image on its way from the render thread to the presenter
+struct RenderedFrame {
+    std::vector<Uint32> pixels;
+    // Set on the first frame rendered after camera input: when that input was issued
+    bool showsNewInput = false;
+    std::chrono::steady_clock::time_point inputIssued;
+    // Full-resolution samples per pixel, 0 for a preview
+    int samples = 0;
+};
+
+// Traces frames on a background thread so the event loop never waits for the tracer.
+// The camera belongs to the render thread once it starts; the event loop changes it
+// only through pushCommand(). Finished frames go through a lock-free triple buffer:
+// the render thread fills its back buffer and swaps it with the middle one, and
+// acquireFrame() swaps the middle one with the front buffer when it is newer.
+//
+// Whole frames (progressive off) can go through a ReprojectionCache while the camera
+// moves; once it stops, the view is traced once more in full.
+class RenderThread {
+public:
+    RenderThread(ThreadPool& pool, bool progressive, int maxSamples, bool reprojection = false);
+    // Cancels the running pass and joins the thread
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // False when too many commands are queued; the command is dropped
+    bool pushCommand(const CameraCommand& command) { return commands.push(command); }
+
+    // The newest frame finished since the last call, or nullptr. It stays valid and
+    // untouched until the next call.
+    const RenderedFrame* acquireFrame();
+
+    // Frames (progressive passes included) finished since the last call
+    int takeRenderedCount() { return renderedCount.exchange(0); }
+
+private:
+    static const int FRESH = 4;
+    static const int INDEX_MASK = 3;
+
+    void run();
+    void publish(bool showsNewInput, std::chrono::steady_clock::time_point inputIssued, int samples);
+
+    ThreadPool& pool;
+    bool progressiveMode;
+    ProgressiveRenderer progressive;
+    bool reprojectionMode;
+    ReprojectionCache reprojection;
+    SpscQueue<CameraCommand, 256> commands;
+
+    RenderedFrame frames[3];
+    int backIndex = 0;
+    int frontIndex = 1;
+    // Index of the middle buffer, plus FRESH when it holds a frame not acquired yet
+    std::atomic<int> middle{2};
+
+    std::atomic<int> renderedCount{0};
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
@@ -0,0 +1,243 @@
+#include "scene.h"
+#include <bit>
+#include <iostream>
+#include "cube.h"
+#include "sphere.h"
+
+void Scene::build(const std::vector<Object*>& objects) {
+    *this = Scene();
+
+    std::vector<AABB> boxBounds;
+    std::vector<int> boxSourceMaterial;
+    std::vector<int> boxSourceTransform;
+    std::vector<AABB> sphereBounds;
+    std::vector<int> sphereSourceMaterial;
+    std::vector<int> sphereSourceTransform;
+
+    for (const auto& object : objects) {
+        int materialId = static_cast<int>(std::find(materials.begin(), materials.end(), object->material) - materials.begin());
+        if (materialId == static_cast<int>(materials.size())) {
+            materials.push_back(object->material);
+        }
+
+        int transform = -1;
+        if (!object->hasIdentityTransform()) {
+            transform = static_cast<int>(normalMatrices.size());
+            normalMatrices.push_back(object->getNormalMatrix());
+        }
+
+        if (dynamic_cast<const Cube*>(object) != nullptr) {
+            boxBounds.push_back(object->getBounds());
+            boxSourceMaterial.push_back(materialId);
+            boxSourceTransform.push_back(transform);
+        } else if (dynamic_cast<const Sphere*>(object) != nullptr) {
+            sphereBounds.push_back(object->getBounds());
+            sphereSourceMaterial.push_back(materialId);
+            sphereSourceTransform.push_back(transform);
+        } else {
+            std::cerr << "Scene: skipping object of unsupported type" << std::endl;
+        }
+    }
+
+    // One BVH over both types, keyed by type so that leaves stay homogeneous
+    std::vector<AABB> bounds = boxBounds;
+    bounds.insert(bounds.end(), sphereBounds.begin(), sphereBounds.end());
+    std::vector<int> keys(boxBounds.size(), 0);
+    keys.resize(bounds.size(), 1);
+    bvh.build(bounds, keys);
+
+    // Store primitives in BVH slot order so each leaf is a contiguous run of one array
+    int sourceBoxes = static_cast<int>(boxBounds.size());
+    for (int source : bvh.getPrimitiveOrder()) {
+        if (source < sourceBoxes) {
+            const AABB& box = boxBounds[source];
+            slotPrimitive.push_back(static_cast<int>(boxMaterial.size()));
+            boxMinX.push_back(box.min.x);
+            boxMinY.push_back(box.min.y);
+            boxMinZ.push_back(box.min.z);
+            boxMaxX.push_back(box.max.x);
+            boxMaxY.push_back(box.max.y);
+            boxMaxZ.push_back(box.max.z);
+            boxMaterial.push_back(boxSourceMaterial[source]);
+            boxTransform.push_back(boxSourceTransform[source]);
+        } else {
+            const AABB& sphere = sphereBounds[source - sourceBoxes];
+            glm::vec3 center = sphere.center();
+            slotPrimitive.push_back(sourceBoxes + static_cast<int>(sphereMaterial.size()));
+            sphereX.push_back(center.x);
+            sphereY.push_back(center.y);
+            sphereZ.push_back(center.z);
+            sphereRadius.push_back((sphere.max.x - sphere.min.x) * 0.5f);
+            sphereMaterial.push_back(sphereSourceMaterial[source - sourceBoxes]);
+            sphereTransform.push_back(sphereSourceTransform[source - sourceBoxes]);
+        }
+    }
+}
+
+bool Scene::closestHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, SceneHit& hit) const {
+    Ray ray(rayOrigin, rayDirection);
+    float zBuffer = 99999;
+    int closest = -1;
+    int boxes = boxCount();
+
+    // Only distances during traversal; the surface is evaluated once for the winner
+    bvh.closestHit(ray, zBuffer, [&](int first, int count, float& tMax) {
+        int start = slotPrimitive[first];
+        if (start < boxes) {
+            for (int box = start; box < start + count; box++) {
+                glm::vec3 minVertex(boxMinX[box], boxMinY[box], boxMinZ[box]);
+                glm::vec3 maxVertex(boxMaxX[box], boxMaxY[box], boxMaxZ[box]);
+                float tMin;
+                if (Cube::slabTest(minVertex, maxVertex, ray, tMin) && tMin < tMax) {
+                    tMax = tMin;
+                    closest = box;
+                }
+            }
+        } else {
+            for (int sphere = start - boxes; sphere < start - boxes + count; sphere++) {
+                glm::vec3 center(sphereX[sphere], sphereY[sphere], sphereZ[sphere]);
+                float dist;
+                if (Sphere::hitDistance(center, sphereRadius[sphere], rayOrigin, rayDirection, dist) && dist < tMax) {
+                    tMax = dist;
+                    closest = boxes + sphere;
+                }
+            }
+        }
+    });
+
+    if (closest < 0) {
+        return false;
+    }
+    hit = surfaceAt(closest, zBuffer, rayOrigin, rayDirection);
+    return true;
+}
+
+bool Scene::occludes(int primitive, const Ray& ray, float maxDist, float& dist) const {
+    bool hit;
+    int boxes = boxCount();
+    if (primitive < boxes) {
+        glm::vec3 minVertex(boxMinX[primitive], boxMinY[primitive], boxMinZ[primitive]);
+        glm::vec3 maxVertex(boxMaxX[primitive], boxMaxY[primitive], boxMaxZ[primitive]);
+        hit = Cube::slabTest(minVertex, maxVertex, ray, dist);
+    } else {
+        int sphere = primitive - boxes;
+        glm::vec3 center(sphereX[sphere], sphereY[sphere], sphereZ[sphere]);
+        hit = Sphere::hitDistance(center, sphereRadius[sphere], ray.origin, ray.direction, dist);
+    }
+    return hit && dist > 0 && dist < maxDist;
+}
+
+bool Scene::anyHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, int ignorePrimitive, float maxDist, float& occluderDist,
+                   int& lastOccluder) const {
+    Ray ray(rayOrigin, rayDirection);
+    // Neighbouring shadow rays are usually blocked by the same primitive
+    if (lastOccluder >= 0 && lastOccluder < boxCount() + sphereCount() && lastOccluder != ignorePrimitive &&
+        occludes(lastOccluder, ray, maxDist, occluderDist)) {
+        return true;
+    }
+
+    return bvh.anyHit(ray, maxDist, [&](int first, int count) {
+        int start = slotPrimitive[first];
+        for (int primitive = start; primitive < start + count; primitive++) {
+            if (primitive != ignorePrimitive && occludes(primitive, ray, maxDist, occluderDist)) {
+                lastOccluder = primitive;
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+template<typename LeafFunction>
+void Scene::traversePacket(RayPacket& packet, const PacketKernels& kernels, const glm::vec3& orderDirection, LeafFunction&& intersectLeaf) const {
+    bvh.traversePacket(packet.activeMask, orderDirection,
+                       [&](const float* bounds, unsigned int laneMask) {
+                           return kernels.intersectBounds(packet, laneMask, bounds);
+                       },
+                       std::forward<LeafFunction>(intersectLeaf));
+}
+
+void Scene::closestHitPacket(RayPacket& packet, const PacketKernels& kernels) const {
+    if (packet.activeMask == 0) {
+        return;
+    }
+    BoxArrays boxes = {boxMinX.data(), boxMinY.data(), boxMinZ.data(), boxMaxX.data(), boxMaxY.data(), boxMaxZ.data()};
+    SphereArrays spheres = {sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data()};
+    int boxCount = this->boxCount();
+
+    // Coherent packets share a direction, so one lane is enough to order the children
+    int lane = std::countr_zero(packet.activeMask);
+    glm::vec3 orderDirection(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+
+    traversePacket(packet, kernels, orderDirection, [&](int first, int count, unsigned int laneMask) {
+        int start = slotPrimitive[first];
+        if (start < boxCount) {
+            kernels.intersectBoxes(packet, laneMask, boxes, start, count, 0, false);
+        } else {
+            kernels.intersectSpheres(packet, laneMask, spheres, start - boxCount, count, boxCount, false);
+        }
+        return 0u;
+    });
+}
+
+unsigned int Scene::anyHitPacket(RayPacket& packet, const PacketKernels& kernels, int& lastOccluder) const {
+    BoxArrays boxes = {boxMinX.data(), boxMinY.data(), boxMinZ.data(), boxMaxX.data(), boxMaxY.data(), boxMaxZ.data()};
+    SphereArrays spheres = {sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data()};
+    int boxCount = this->boxCount();
+    unsigned int occluded = 0;
+
+    // Lanes the last occluder blocks skip the traversal
+    if (lastOccluder >= 0 && lastOccluder < boxCount + sphereCount()) {
+        occluded = lastOccluder < boxCount
+                ? kernels.intersectBoxes(packet, packet.activeMask, boxes, lastOccluder, 1, 0, true)
+                : kernels.intersectSpheres(packet, packet.activeMask, spheres, lastOccluder - boxCount, 1, boxCount, true);
+    }
+    unsigned int activeMask = packet.activeMask;
+    packet.activeMask &= ~occluded;
+
+    // Same leaf order as anyHit(), so every lane reports the occluder the scalar path finds
+    traversePacket(packet, kernels, glm::vec3(0.0f), [&](int first, int count, unsigned int laneMask) {
+        int start = slotPrimitive[first];
+        unsigned int hitMask = start < boxCount
+                ? kernels.intersectBoxes(packet, laneMask, boxes, start, count, 0, true)
+                : kernels.intersectSpheres(packet, laneMask, spheres, start - boxCount, count, boxCount, true);
+        if (hitMask != 0) {
+            lastOccluder = packet.primitive[std::bit_width(hitMask) - 1];
+        }
+        occluded |= hitMask;
+        return hitMask;
+    });
+    packet.activeMask = activeMask;
+    return occluded;
+}
+
+SceneHit Scene::surfaceAt(int primitive, float dist, const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    SceneHit hit;
+    hit.primitive = primitive;
+    if (primitive < boxCount()) {
+        glm::vec3 minVertex(boxMinX[primitive], boxMinY[primitive], boxMinZ[primitive]);
+        glm::vec3 maxVertex(boxMaxX[primitive], boxMaxY[primitive], boxMaxZ[primitive]);
+        hit.intersect = Cube::surfaceAt(minVertex, maxVertex, rayOrigin, rayDirection, dist);
+        hit.materialId = boxMaterial[primitive];
+    } else {
+        int sphere = primitive - boxCount();
+        glm::vec3 center(sphereX[sphere], sphereY[sphere], sphereZ[sphere]);
+        hit.intersect = Sphere::surfaceAt(center, rayOrigin, rayDirection, dist);
+        hit.materialId = sphereMaterial[sphere];
+    }
+    return hit;
+}
+
+size_t Scene::memoryFootprint() const {
+    size_t bytes = sizeof(Scene);
+    for (const auto* array : {&boxMinX, &boxMinY, &boxMinZ, &boxMaxX, &boxMaxY, &boxMaxZ, &sphereX, &sphereY, &sphereZ, &sphereRadius}) {
+        bytes += array->capacity() * sizeof(float);
+    }
+    for (const auto* array : {&boxMaterial, &boxTransform, &sphereMaterial, &sphereTransform, &slotPrimitive}) {
+        bytes += array->capacity() * sizeof(int);
+    }
+    bytes += materials.capacity() * sizeof(Material);
+    bytes += normalMatrices.capacity() * sizeof(glm::mat3);
+    bytes += bvh.memoryFootprint();
+    return bytes;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "bvh.h"
+#include "intersect.h"
+#include "material.h"
+#include "object.h"
+#include "packet.h"
+
+struct SceneHit {
+    Intersect intersect;
+    int primitive = -1;
+    int materialId = 0;
+};
+
+// Flattened, structure-of-arrays copy of the scene objects. Boxes and spheres
+// live in separate contiguous arrays, stored in BVH leaf order. Leaves never
+// mix types, so each one is a tight loop over a run of one array. Materials are
+// shared through an index into a deduplicated table.
+//
+// Primitive IDs are box indices first, then sphere indices offset by boxCount().
+class Scene {
+public:
+    void build(const std::vector<Object*>& objects);
+
+    bool closestHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, SceneHit& hit) const;
+
+    // Occlusion query: a hit in front of the origin and closer than maxDist, skipping
+    // ignorePrimitive; only its distance is computed. lastOccluder is tested before the
+    // BVH and is set to the occluder found there, so a caller can keep it between rays.
+    bool anyHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, int ignorePrimitive, float maxDist, float& occluderDist,
+                int& lastOccluder) const;
+
+    // Packet versions for the lanes in packet.activeMask. closestHitPacket() only leaves
+    // tMax and primitive per lane; surfaceAt() turns one of them into a full SceneHit.
+    void closestHitPacket(RayPacket& packet, const PacketKernels& kernels) const;
+    // Returns the occluded lanes; ignorePrimitive and tMax (the longest occluder distance
+    // that counts) are read per lane. lastOccluder works as in anyHit().
+    unsigned int anyHitPacket(RayPacket& packet, const PacketKernels& kernels, int& lastOccluder) const;
+
+    SceneHit surfaceAt(int primitive, float dist, const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const;
+
+    const Material& getMaterial(int materialId) const { return materials[materialId]; }
+    // Changes every primitive sharing the material; no rebuild needed
+    void setMaterial(int materialId, const Material& material) { materials[materialId] = material; }
+    int materialCount() const { return static_cast<int>(materials.size()); }
+
+    // nullptr for primitives whose object has an identity transform
+    const glm::mat3* getNormalMatrix(int primitive) const {
+        int transform = primitive < boxCount() ? boxTransform[primitive] : sphereTransform[primitive - boxCount()];
+        return transform >= 0 ? &normalMatrices[transform] : nullptr;
+    }
+
+    int boxCount() const { return static_cast<int>(boxMaterial.size()); }
+    int sphereCount() const { return static_cast<int>(sphereMaterial.size()); }
+    size_t memoryFootprint() const;
+
+private:
+    // Entry distance of the ray into primitive when it is in (0, maxDist)
+    bool occludes(int primitive, const Ray& ray, float maxDist, float& dist) const;
+
+    template<typename LeafFunction>
+    void traversePacket(RayPacket& packet, const PacketKernels& kernels, const glm::vec3& orderDirection, LeafFunction&& intersectLeaf) const;
+
+    std::vector<float> boxMinX, boxMinY, boxMinZ;
+    std::vector<float> boxMaxX, boxMaxY, boxMaxZ;
+    std::vector<int> boxMaterial;
+    std::vector<int> boxTransform;
+
+    std::vector<float> sphereX, sphereY, sphereZ;
+    std::vector<float> sphereRadius;
+    std::vector<int> sphereMaterial;
+    std::vector<int> sphereTransform;
+
+    // Primitive ID stored in each BVH slot; a leaf's first slot gives its type and start
+    std::vector<int> slotPrimitive;
+    BVH bvh;
+
+    std::vector<Material> materials;
+    std::vector<glm::mat3> normalMatrices;
+};
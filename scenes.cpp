@@ -0,0 +1,535 @@
+#include "scenes.h"
+#include <cmath>
+#include <stdexcept>
+#include "renderer.h"
+#include "cube.h"
+#include "sphere.h"
+
+std::string assetDirectory = "../assets";
+bool useVoxelWorld = false;
+std::string worldFile;
+size_t worldBudget = 64 << 20;
+TextureCache textureCache;
+
+std::string assetPath(const std::string& file) {
+    return assetDirectory + "/" + file;
+}
+
+const Texture* loadTexture(const std::string& file) {
+    return textureCache.load(file);
+}
+
+void setUp() {
+
+    Material stone = {
+            Color(80, 0, 0),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.0f,
+            1.6f,
+            loadTexture(assetPath("stone.png"))
+    };
+
+    //Era lava pero termino pareciendo esmeralda :/
+    Material lava = {
+            Color(80, 0, 0),
+            0.9f,
+            1.0f,
+            150.0f,
+            0.2f,
+            0.0f,
+            0.0f,
+            loadTexture(assetPath("lava.png"))
+    };
+
+    //diamond que terminó siendo carbon :/
+
+    Material diamond(
+            Color(80, 0, 0),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.0f,
+            1.6f,
+            loadTexture(assetPath("diamond.png"))
+
+    );
+
+    //iron
+    Material iron(
+            Color(80, 0, 0),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.0f,
+            1.6f,
+            loadTexture(assetPath("iron.png"))
+
+    );
+
+    // diamond block
+    Material obsidian(
+            Color(80, 0, 0),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.0f,
+            1.6f,
+            loadTexture(assetPath("obsidian.png"))
+
+    );
+
+    // dirt block
+    Material dirt(
+            Color(255, 255, 255),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.0f,
+            1.6f,
+            loadTexture(assetPath("dirt.png"))
+
+    );
+
+    // portal
+    Material portal(
+            Color(75,0,130),   // diffuse
+            0.3,
+            0.5,
+            3.0f,
+            0.0f,
+            0.2f,
+            0.0f,
+            loadTexture(assetPath("portal.png"))
+
+    );
+
+    // Piso
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, 1.0f), glm::vec3(2.0f, -2.0f, 2.0f), lava));
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, 0.0f), glm::vec3(2.0f, -2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, 2.0f), glm::vec3(2.0f, -2.0f, 3.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, 3.0f), glm::vec3(2.0f, -2.0f, 4.0f), stone));
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, 4.0f), glm::vec3(2.0f, -2.0f, 5.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(1.0f, -3.0f, -1.0f), glm::vec3(2.0f, -2.0f, 0.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(2.0f, -3.0f, -1.0f), glm::vec3(3.0f, -2.0f, 0.0f), lava));
+    objects.push_back(new Cube(glm::vec3(2.0f, -3.0f, 2.0f), glm::vec3(3.0f, -2.0f, 3.0f), stone));
+    objects.push_back(new Cube(glm::vec3(2.0f, -3.0f, 1.0f), glm::vec3(3.0f, -2.0f, 2.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(2.0f, -3.0f, 0.0f), glm::vec3(3.0f, -2.0f, 1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(2.0f, -3.0f, 3.0f), glm::vec3(3.0f, -2.0f, 4.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(3.0f, -3.0f, -1.0f), glm::vec3(4.0f, -2.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(3.0f, -3.0f, 0.0f), glm::vec3(4.0f, -2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(3.0f, -3.0f, 1.0f), glm::vec3(4.0f, -2.0f, 2.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(3.0f, -3.0f, 2.0f), glm::vec3(4.0f, -2.0f, 3.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, -1.0f), glm::vec3(1.0f, -2.0f, 0.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, 0.0f), glm::vec3(1.0f, -2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, 1.0f), glm::vec3(1.0f, -2.0f, 2.0f), iron));
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, 2.0f), glm::vec3(1.0f, -2.0f, 3.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, 3.0f), glm::vec3(1.0f, -2.0f, 4.0f), iron));
+    objects.push_back(new Cube(glm::vec3(0.0f, -3.0f, 4.0f), glm::vec3(1.0f, -2.0f, 5.0f), stone));
+
+    // Estructura portal
+
+    objects.push_back(new Cube(glm::vec3(0.0f, -2.0f, 1.0f), glm::vec3(1.0f, -1.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, -2.0f, 1.0f), glm::vec3(2.0f, -1.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -2.0f, 1.0f), glm::vec3(0.0f, -1.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -2.0f, 1.0f), glm::vec3(-1.0f, -1.0f, 2.0f), obsidian));
+
+    objects.push_back(new Cube(glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(2.0f, 0.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(2.0f, 1.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(2.0f, 2.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, 2.0f, 1.0f), glm::vec3(2.0f, 3.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, 2.0f, 1.0f), glm::vec3(2.0f, 3.0f, 2.0f), obsidian));
+
+    objects.push_back(new Cube(glm::vec3(-2.0f, -1.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 0.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 1.0f, 1.0f), glm::vec3(-1.0f, 2.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 2.0f, 1.0f), glm::vec3(-1.0f, 3.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 2.0f, 1.0f), glm::vec3(-1.0f, 3.0f, 2.0f), obsidian));
+
+    //portal
+    objects.push_back(new Cube(glm::vec3(-1.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 2.0f), portal));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(0.0f, 0.0f, 2.0f), portal));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 2.0f, 2.0f), portal));
+    objects.push_back(new Cube(glm::vec3(0.0f, -1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 2.0f), portal));
+    objects.push_back(new Cube(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 2.0f), portal));
+    objects.push_back(new Cube(glm::vec3(0.0f, 1.0f, 1.0f), glm::vec3(1.0f, 2.0f, 2.0f), portal));
+
+    objects.push_back(new Cube(glm::vec3(0.0f, 2.0f, 1.0f), glm::vec3(1.0f, 3.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(1.0f, 2.0f, 1.0f), glm::vec3(2.0f, 3.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 2.0f, 1.0f), glm::vec3(0.0f, 3.0f, 2.0f), obsidian));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 2.0f, 1.0f), glm::vec3(-1.0f, 3.0f, 2.0f), obsidian));
+
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, -1.0f), glm::vec3(0.0f, -2.0f, 0.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, 0.0f), glm::vec3(0.0f, -2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, 1.0f), glm::vec3(0.0f, -2.0f, 2.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, 2.0f), glm::vec3(0.0f, -2.0f, 3.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, 3.0f), glm::vec3(0.0f, -2.0f, 4.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -3.0f, 4.0f), glm::vec3(0.0f, -2.0f, 5.0f), stone));
+
+
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, -1.0f), glm::vec3(-1.0f, -2.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, 0.0f), glm::vec3(-1.0f, -2.0f, 1.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, 1.0f), glm::vec3(-1.0f, -2.0f, 2.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, 2.0f), glm::vec3(-1.0f, -2.0f, 3.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, 3.0f), glm::vec3(-1.0f, -2.0f, 4.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -3.0f, 4.0f), glm::vec3(-1.0f, -2.0f, 5.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, -3.0f, -1.0f), glm::vec3(-2.0f, -2.0f, 0.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-3.0f, -3.0f, 0.0f), glm::vec3(-2.0f, -2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-3.0f, -3.0f, 1.0f), glm::vec3(-2.0f, -2.0f, 2.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(-3.0f, -3.0f, 2.0f), glm::vec3(-2.0f, -2.0f, 3.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-3.0f, -3.0f, 3.0f), glm::vec3(-2.0f, -2.0f, 4.0f), stone));
+
+
+
+    //pared
+    objects.push_back(new Cube(glm::vec3(-3.0f, -2.0f, -2.0f), glm::vec3(-2.0f, -1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -2.0f, -2.0f), glm::vec3(-1.0f, -1.0f, -1.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -2.0f, -2.0f), glm::vec3(0.0f, -1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, -2.0f, -2.0f), glm::vec3(1.0f, -1.0f, -1.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(1.0f, -2.0f, -2.0f), glm::vec3(2.0f, -1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(2.0f, -2.0f, -2.0f), glm::vec3(3.0f, -1.0f, -1.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(3.0f, -2.0f, -2.0f), glm::vec3(4.0f, -1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, -2.0f, -2.0f), glm::vec3(5.0f, -1.0f, -1.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, -1.0f, -2.0f), glm::vec3(-2.0f, 0.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, -1.0f, -2.0f), glm::vec3(-1.0f, 0.0f, -1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(-1.0f, -1.0f, -2.0f), glm::vec3(0.0f, 0.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, -1.0f, -2.0f), glm::vec3(1.0f, 0.0f, -1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(1.0f, -1.0f, -2.0f), glm::vec3(2.0f, 0.0f, -1.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(2.0f, -1.0f, -2.0f), glm::vec3(3.0f, 0.0f, -1.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(3.0f, -1.0f, -2.0f), glm::vec3(4.0f, 0.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, -1.0f, -2.0f), glm::vec3(5.0f, 0.0f, -1.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, 0.0f, -2.0f), glm::vec3(-2.0f, 1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 0.0f, -2.0f), glm::vec3(-1.0f, 1.0f, -1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(1.0f, 1.0f, -1.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(1.0f, 0.0f, -2.0f), glm::vec3(2.0f, 1.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(2.0f, 0.0f, -2.0f), glm::vec3(3.0f, 1.0f, -1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(3.0f, 0.0f, -2.0f), glm::vec3(4.0f, 1.0f, -1.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, 1.0f, -2.0f), glm::vec3(-2.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 1.0f, -2.0f), glm::vec3(-1.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 1.0f, -2.0f), glm::vec3(0.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, 1.0f, -2.0f), glm::vec3(1.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(1.0f, 1.0f, -2.0f), glm::vec3(2.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(2.0f, 1.0f, -2.0f), glm::vec3(3.0f, 2.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(3.0f, 1.0f, -2.0f), glm::vec3(4.0f, 2.0f, -1.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, 2.0f, -2.0f), glm::vec3(-2.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 2.0f, -2.0f), glm::vec3(-1.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 2.0f, -2.0f), glm::vec3(0.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, 2.0f, -2.0f), glm::vec3(1.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(1.0f, 2.0f, -2.0f), glm::vec3(2.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(2.0f, 2.0f, -2.0f), glm::vec3(3.0f, 3.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(3.0f, 2.0f, -2.0f), glm::vec3(4.0f, 3.0f, -1.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(-3.0f, 3.0f, -2.0f), glm::vec3(-2.0f, 4.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(-2.0f, 3.0f, -2.0f), glm::vec3(-1.0f, 4.0f, -1.0f), lava));
+    objects.push_back(new Cube(glm::vec3(-1.0f, 3.0f, -2.0f), glm::vec3(0.0f, 4.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(0.0f, 3.0f, -2.0f), glm::vec3(1.0f, 4.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(1.0f, 3.0f, -2.0f), glm::vec3(2.0f, 4.0f, -1.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(2.0f, 3.0f, -2.0f), glm::vec3(3.0f, 4.0f, -1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(3.0f, 3.0f, -2.0f), glm::vec3(4.0f, 4.0f, -1.0f), stone));
+
+
+    objects.push_back(new Cube(glm::vec3(4.0f, 1.0f, -1.0f), glm::vec3(5.0f, 2.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 1.0f, 0.0f), glm::vec3(5.0f, 2.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 1.0f, 1.0f), glm::vec3(5.0f, 2.0f, 2.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 1.0f, 2.0f), glm::vec3(5.0f, 2.0f, 3.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(4.0f, 2.0f, -1.0f), glm::vec3(5.0f, 3.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 2.0f, 0.0f), glm::vec3(5.0f, 3.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 2.0f, 1.0f), glm::vec3(5.0f, 3.0f, 2.0f), diamond));
+
+    objects.push_back(new Cube(glm::vec3(4.0f, 3.0f, -1.0f), glm::vec3(5.0f, 4.0f, 0.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(4.0f, 3.0f, 0.0f), glm::vec3(5.0f, 4.0f, 1.0f), stone));
+
+
+    objects.push_back(new Cube(glm::vec3(4.0f, 0.0f, -1.0f), glm::vec3(5.0f, 1.0f, 0.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(4.0f, 0.0f, 0.0f), glm::vec3(5.0f, 1.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, 0.0f, 1.0f), glm::vec3(5.0f, 1.0f, 2.0f), lava));
+    objects.push_back(new Cube(glm::vec3(4.0f, 0.0f, 2.0f), glm::vec3(5.0f, 1.0f, 3.0f), stone));
+
+
+    objects.push_back(new Cube(glm::vec3(4.0f, -1.0f, -1.0f), glm::vec3(5.0f, 0.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, -1.0f, 0.0f), glm::vec3(5.0f, 0.0f, 1.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, -1.0f, 1.0f), glm::vec3(5.0f, 0.0f, 2.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(4.0f, -1.0f, 2.0f), glm::vec3(5.0f, 0.0f, 3.0f), stone));
+
+    objects.push_back(new Cube(glm::vec3(4.0f, -2.0f, -1.0f), glm::vec3(5.0f, -1.0f, 0.0f), stone));
+    objects.push_back(new Cube(glm::vec3(4.0f, -2.0f, 0.0f), glm::vec3(5.0f, -1.0f, 1.0f), dirt));
+    objects.push_back(new Cube(glm::vec3(4.0f, -2.0f, 1.0f), glm::vec3(5.0f, -1.0f, 2.0f), diamond));
+    objects.push_back(new Cube(glm::vec3(4.0f, -2.0f, 2.0f), glm::vec3(5.0f, -1.0f, 3.0f), stone));
+
+
+    // Flattened once here; build again after moving or adding objects
+    scene.build(objects);
+}
+
+void buildVoxelWorld() {
+    AABB sceneBounds;
+    for (const auto& object : objects) {
+        sceneBounds.expand(object->getBounds());
+    }
+    if (sceneBounds.isEmpty()) {
+        return;
+    }
+
+    glm::ivec3 worldMin(glm::floor(sceneBounds.min));
+    glm::ivec3 worldMax(glm::floor(sceneBounds.max));
+    world = new VoxelWorld(worldMin, worldMax - worldMin + glm::ivec3(1));
+
+    std::vector<std::pair<Material, Uint8>> palette;
+    auto materialId = [&palette](const Material& material) {
+        for (const auto& [known, id] : palette) {
+            if (known == material) {
+                return id;
+            }
+        }
+        Uint8 id = world->addMaterial(material);
+        palette.emplace_back(material, id);
+        return id;
+    };
+
+    std::vector<Object*> remaining;
+    for (auto& object : objects) {
+        AABB bounds = object->getBounds();
+        glm::vec3 extent = bounds.max - bounds.min;
+        bool isBlock = extent == glm::vec3(1.0f) && glm::floor(bounds.min) == bounds.min;
+        if (isBlock) {
+            world->setBlock(glm::ivec3(bounds.min), materialId(object->material));
+            delete object;
+        } else {
+            remaining.push_back(object);
+        }
+    }
+
+    world->compact();
+
+    objects = remaining;
+    scene.build(objects);
+}
+
+void loadScene() {
+    if (!worldFile.empty()) {
+        setUpStreamedTerrain(worldFile, worldBudget);
+        return;
+    }
+    setUp();
+    if (useVoxelWorld) {
+        buildVoxelWorld();
+    }
+}
+
+void setUpGlassScene() {
+    Material mirror = {Color(255, 255, 255), 0.1f, 1.0f, 500.0f, 0.8f, 0.0f, 0.0f, nullptr};
+    Material glass = {Color(200, 230, 255), 0.1f, 1.0f, 300.0f, 0.1f, 0.8f, 1.5f, nullptr};
+    Material obsidian = {Color(80, 0, 0), 0.3f, 0.5f, 3.0f, 0.3f, 0.0f, 0.0f, loadTexture(assetPath("obsidian.png"))};
+    Material diamond = {Color(80, 0, 0), 0.3f, 0.5f, 3.0f, 0.3f, 0.0f, 0.0f, loadTexture(assetPath("diamond.png"))};
+
+    // Reflective checkered floor
+    for (int z = -6; z < 6; z++) {
+        for (int x = -6; x < 6; x++) {
+            glm::vec3 minVertex(x, -3.0f, z);
+            objects.push_back(new Cube(minVertex, minVertex + glm::vec3(1.0f), (x + z) % 2 == 0 ? obsidian : diamond));
+        }
+    }
+
+    // Alternating mirror and glass spheres
+    for (int z = -2; z <= 2; z++) {
+        for (int x = -2; x <= 2; x++) {
+            glm::vec3 center(x * 2.0f, -1.2f, z * 2.0f);
+            objects.push_back(new Sphere(center, 0.8f, (x + z) % 2 == 0 ? mirror : glass));
+        }
+    }
+    scene.build(objects);
+
+    camera.position = glm::vec3(-5.0f, 3.0f, 12.0f);
+    camera.target = glm::vec3(0.0f, -1.0f, 0.0f);
+    light.position = glm::vec3(-5.0f, 8.0f, 10.0f);
+}
+
+namespace {
+    struct TerrainIds {
+        Uint8 stone;
+        Uint8 dirt;
+        Uint8 lava;
+    };
+
+    TerrainIds addTerrainMaterials(VoxelWorld& terrain) {
+        Material stone = {Color(80, 0, 0), 0.3f, 0.5f, 3.0f, 0.0f, 0.0f, 1.6f, loadTexture(assetPath("stone.png"))};
+        Material dirt = {Color(255, 255, 255), 0.3f, 0.5f, 3.0f, 0.0f, 0.0f, 1.6f, loadTexture(assetPath("dirt.png"))};
+        Material lava = {Color(80, 0, 0), 0.9f, 1.0f, 150.0f, 0.2f, 0.0f, 0.0f, loadTexture(assetPath("lava.png"))};
+        TerrainIds ids;
+        ids.stone = terrain.addMaterial(stone);
+        ids.dirt = terrain.addMaterial(dirt);
+        ids.lava = terrain.addMaterial(lava);
+        return ids;
+    }
+
+    // Columns of the worldSize^3 heightmap with z in [z0, z1)
+    void fillTerrain(VoxelWorld& terrain, const TerrainIds& ids, int worldSize, int z0, int z1) {
+        int seaLevel = worldSize / 4;
+        for (int z = z0; z < z1; z++) {
+            for (int x = 0; x < worldSize; x++) {
+                float hills = std::sin(x * 0.05f) + std::cos(z * 0.07f) + 0.5f * std::sin((x + z) * 0.13f);
+                int height = std::clamp(static_cast<int>(seaLevel + hills * worldSize / 12.0f), 1, worldSize - 1);
+                for (int y = 0; y < height; y++) {
+                    terrain.setBlock(glm::ivec3(x, y, z), y == height - 1 ? ids.dirt : ids.stone);
+                }
+                for (int y = height; y < seaLevel; y++) {
+                    terrain.setBlock(glm::ivec3(x, y, z), ids.lava);
+                }
+            }
+        }
+        terrain.compact();
+    }
+
+    void placeTerrainCamera(const glm::ivec3& worldSize) {
+        float size = static_cast<float>(worldSize.x);
+        camera.position = glm::vec3(-0.1f * size, 0.6f * size, -0.1f * size);
+        camera.target = glm::vec3(0.5f * size, 0.2f * size, 0.5f * size);
+        light.position = glm::vec3(0.3f * size, 2.0f * size, 0.2f * size);
+    }
+}
+
+void setUpTerrain(int worldSize) {
+    world = new VoxelWorld(glm::ivec3(0), glm::ivec3(worldSize));
+    TerrainIds ids = addTerrainMaterials(*world);
+    fillTerrain(*world, ids, worldSize, 0, worldSize);
+    scene.build(objects);
+    placeTerrainCamera(world->getSize());
+}
+
+void writeTerrain(const std::string& path, int worldSize) {
+    const int slabDepth = ChunkStream::CHUNK_SIZE;
+    ChunkWriter writer(path, glm::ivec3(0), glm::ivec3(worldSize));
+    for (int z0 = 0; z0 < worldSize; z0 += slabDepth) {
+        int z1 = std::min(z0 + slabDepth, worldSize);
+        VoxelWorld slab(glm::ivec3(0, 0, z0), glm::ivec3(worldSize, worldSize, z1 - z0));
+        TerrainIds ids = addTerrainMaterials(slab);
+        fillTerrain(slab, ids, worldSize, z0, z1);
+        slab.writeChunks(writer);
+    }
+    writer.finish();
+}
+
+void setUpStreamedTerrain(const std::string& path, size_t residentBudget) {
+    world = new VoxelWorld(path, residentBudget);
+    addTerrainMaterials(*world);
+    size_t fileMaterials = world->getStream()->materialCount();
+    size_t terrainMaterials = world->materialCount();
+    if (fileMaterials > terrainMaterials) {
+        clearScene();
+        throw std::runtime_error(path + " uses " + std::to_string(fileMaterials) + " materials, the terrain has " + std::to_string(terrainMaterials));
+    }
+    scene.build(objects);
+    placeTerrainCamera(world->getSize());
+}
+
+void setUpRandomBlocks(int cubeCount, int sphereCount) {
+    std::mt19937 rng(1234);
+    objects = makeRandomBlocks(cubeCount, sphereCount, rng);
+    scene.build(objects);
+
+    float side = static_cast<float>(blockRegionSide(cubeCount + sphereCount));
+    camera.position = glm::vec3(1.2f * side, 0.6f * side, 1.2f * side);
+    camera.target = glm::vec3(0.0f);
+    light.position = glm::vec3(0.5f * side, 2.0f * side, 0.8f * side);
+}
+
+void setUpLavaField(int lightCount) {
+    Material stone = {Color(80, 0, 0), 0.3f, 0.5f, 3.0f, 0.0f, 0.0f, 1.6f, loadTexture(assetPath("stone.png"))};
+    Material lava = {Color(80, 0, 0), 0.9f, 1.0f, 150.0f, 0.2f, 0.0f, 0.0f, loadTexture(assetPath("lava.png"))};
+
+    int side = 64;
+    world = new VoxelWorld(glm::ivec3(0), glm::ivec3(side, 8, side));
+    Uint8 stoneId = world->addMaterial(stone);
+    Uint8 lavaId = world->addMaterial(lava);
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            world->setBlock(glm::ivec3(x, 0, z), stoneId);
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> cell(0, side - 1);
+    std::uniform_int_distribution<int> height(1, 5);
+    for (int i = 0; i < side * side / 20; i++) {
+        glm::ivec3 pillar(cell(rng), 1, cell(rng));
+        for (int top = height(rng); pillar.y <= top; pillar.y++) {
+            world->setBlock(pillar, stoneId);
+        }
+    }
+
+    std::vector<Light> sceneLights;
+    lightCount = std::min(lightCount, side * side / 2);
+    for (int i = 0; i < lightCount; i++) {
+        // Lights go on free floor cells, up to one per cell
+        glm::ivec3 floor(cell(rng), 1, cell(rng));
+        while (world->getBlock(floor) != VoxelWorld::EMPTY || world->getBlock(floor + glm::ivec3(0, 1, 0)) != VoxelWorld::EMPTY) {
+            floor = glm::ivec3(cell(rng), 1, cell(rng));
+        }
+        if (i % 50 == 49) {
+            sceneLights.push_back(Light{glm::vec3(floor.x, 7.5f, floor.z), 2.0f, Color(180, 200, 255), LightType::Area,
+                                        glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 2.0f)});
+        } else if (i % 10 == 9) {
+            // Torches mark their cell with a block below the flame
+            world->setBlock(floor, stoneId);
+            sceneLights.push_back(Light{glm::vec3(floor) + glm::vec3(0.5f, 1.5f, 0.5f), 3.0f, Color(255, 180, 90)});
+        } else {
+            world->setBlock(floor, lavaId);
+            sceneLights.push_back(Light{glm::vec3(floor), 4.0f, Color(255, 120, 40), LightType::Block});
+        }
+    }
+    world->compact();
+    lights.build(sceneLights);
+    scene.build(objects);
+
+    camera.position = glm::vec3(-8.0f, 24.0f, -8.0f);
+    camera.target = glm::vec3(0.5f * side, 0.0f, 0.5f * side);
+    light.position = glm::vec3(0.3f * side, 4.0f * side, 0.2f * side);
+}
+
+void clearScene() {
+    for (auto& object : objects) {
+        delete object;
+    }
+    objects.clear();
+    delete world;
+    world = nullptr;
+    scene.build(objects);
+    lights.build({});
+}
+
+int blockRegionSide(int count) {
+    return static_cast<int>(std::ceil(std::cbrt(count * 10.0)));
+}
+
+std::vector<Object*> makeRandomBlocks(int cubeCount, int sphereCount, std::mt19937& rng) {
+    Material white = {Color(255, 255, 255), 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, nullptr};
+    int side = blockRegionSide(cubeCount + sphereCount);
+    std::uniform_int_distribution<int> cell(-side / 2, side / 2);
+
+    std::vector<Object*> blocks;
+    for (int i = 0; i < cubeCount; i++) {
+        glm::vec3 minVertex(cell(rng), cell(rng), cell(rng));
+        blocks.push_back(new Cube(minVertex, minVertex + glm::vec3(1.0f), white));
+    }
+    for (int i = 0; i < sphereCount; i++) {
+        glm::vec3 center(cell(rng), cell(rng), cell(rng));
+        blocks.push_back(new Sphere(center + glm::vec3(0.5f), 0.5f, white));
+    }
+    return blocks;
+}
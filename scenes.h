@@ -0,0 +1,61 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "object.h"
+#include "texture.h"
+
+// Texture directory; main() sets it from RenderOptions
+extern std::string assetDirectory;
+// loadScene() moves the diorama's blocks into a VoxelWorld when set
+extern bool useVoxelWorld;
+// loadScene() streams the terrain in this chunk file instead when set, keeping
+// worldBudget bytes of it in memory
+extern std::string worldFile;
+extern size_t worldBudget;
+// Owns every texture loaded through loadTexture()
+extern TextureCache textureCache;
+
+std::string assetPath(const std::string& file);
+const Texture* loadTexture(const std::string& file);
+
+// Each setUp function fills objects (and world, for terrain), builds the scene and
+// places camera and light at the scene's fixed pose.
+
+// The Minecraft portal diorama
+void setUp();
+// The diorama, or the terrain in worldFile; throws std::runtime_error when that can't be streamed
+void loadScene();
+// Moves unit, grid-aligned cubes out of `objects` into a VoxelWorld; anything else stays in the Scene
+void buildVoxelWorld();
+
+// Mirror and glass spheres over a reflective checkered floor: mostly secondary rays
+void setUpGlassScene();
+
+// Heightmap terrain of worldSize^3 cells in a VoxelWorld
+void setUpTerrain(int worldSize);
+// The same terrain as a chunk file, generated CHUNK_SIZE rows at a time so that it
+// needn't fit in memory. Throws std::runtime_error when the file can't be written.
+void writeTerrain(const std::string& path, int worldSize);
+// Terrain streamed from a file written by writeTerrain(), residentBudget bytes of it in
+// memory. Throws std::runtime_error when the file can't be opened or is corrupt.
+void setUpStreamedTerrain(const std::string& path, size_t residentBudget);
+
+// Random unit cubes and spheres through the Scene BVH
+void setUpRandomBlocks(int cubeCount, int sphereCount);
+
+// Stone floor with pillars in a VoxelWorld, lit by lightCount lights in the light tree:
+// mostly lava blocks, with torches (point lights) and overhead panels (area lights).
+// At most 2048 lights.
+void setUpLavaField(int lightCount);
+
+// Deletes objects and world so another scene can be set up
+void clearScene();
+
+// Side of the cubic region in which roughly 10% of the cells hold one of `count` blocks
+int blockRegionSide(int count);
+
+// Random unit cubes (and optionally spheres) on integer cells of a blockRegionSide() region
+std::vector<Object*> makeRandomBlocks(int cubeCount, int sphereCount, std::mt19937& rng);
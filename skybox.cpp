@@ -5,48 +5,70 @@ Skybox::Skybox(const std::string& textureFile) {
     loadAndConvertTexture(textureFile);
 }
 
-Skybox::~Skybox() {
-    if (texture != nullptr) {
-        SDL_FreeSurface(texture);
-        texture = nullptr;
-    }
-}
-
 void Skybox::loadAndConvertTexture(const std::string& textureFile) {
     SDL_Surface* rawTexture = IMG_Load(textureFile.c_str());
     if (rawTexture == nullptr) {
         throw std::runtime_error("Error loading image: " + std::string(SDL_GetError()));
     }
 
-    texture = SDL_ConvertSurfaceFormat(rawTexture, SDL_PIXELFORMAT_RGB24, 0);
-    if (texture == nullptr) {
+    std::unique_ptr<Texture> equirect;
+    try {
+        equirect = std::make_unique<Texture>(rawTexture, TextureWrap::RepeatU);
+    } catch (const std::runtime_error&) {
         SDL_FreeSurface(rawTexture);
-        throw std::runtime_error("Error converting texture to RGB: " + std::string(SDL_GetError()));
+        throw;
     }
-
     SDL_FreeSurface(rawTexture);
-}
-
-Color Skybox::getColor(const glm::vec3& direction) const {
-    float phi = atan2(direction.z, direction.x);
-    float theta = acos(direction.y);
-
-    float u = 0.5f + phi / (2 * M_PI);
-    float v = theta / M_PI;
 
-    int x = static_cast<int>(u * texture->w) % texture->w;
-    int y = static_cast<int>(v * texture->h) % texture->h;
+    // A face spans 90 degrees, a quarter of the image width, at the same texel density
+    int faceSize = std::max(1, equirect->getWidth() / 4);
+    texelsPerRadian = faceSize / 2.0f;
 
-    x = std::clamp(x, 0, texture->w - 1);
-    y = std::clamp(y, 0, texture->h - 1);
+    SDL_Surface* faceSurface = SDL_CreateRGBSurfaceWithFormat(0, faceSize, faceSize, 32, SDL_PIXELFORMAT_RGBA32);
+    if (faceSurface == nullptr) {
+        throw std::runtime_error("Error creating cubemap face: " + std::string(SDL_GetError()));
+    }
+    for (int face = 0; face < FACE_COUNT; face++) {
+        SDL_LockSurface(faceSurface);
+        for (int y = 0; y < faceSize; y++) {
+            Uint8* row = static_cast<Uint8*>(faceSurface->pixels) + y * faceSurface->pitch;
+            for (int x = 0; x < faceSize; x++) {
+                float s = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+                float t = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+                glm::vec3 direction = glm::normalize(faceDirection(face, s, t));
 
-    Uint8 r, g, b;
-    Uint8* pixel = &((Uint8*)texture->pixels)[3 * (y * texture->w + x)];
-    r = pixel[0];
-    g = pixel[1];
-    b = pixel[2];
+                float phi = atan2(direction.z, direction.x);
+                float theta = acos(direction.y);
+                Radiance color = equirect->sampleBilinear(0.5f + phi / (2 * M_PI), theta / M_PI);
 
-    return Color(r, g, b);
+                Uint8* p = row + x * 4;
+                p[0] = linearToSrgb(color.x);
+                p[1] = linearToSrgb(color.y);
+                p[2] = linearToSrgb(color.z);
+                p[3] = 255;
+            }
+        }
+        SDL_UnlockSurface(faceSurface);
+        faces[face] = std::make_unique<Texture>(faceSurface, TextureWrap::Clamp);
+    }
+    SDL_FreeSurface(faceSurface);
 }
 
+glm::vec3 Skybox::faceDirection(int face, float s, float t) {
+    switch (face) {
+        case 0: return {1.0f, -t, -s};
+        case 1: return {-1.0f, -t, s};
+        case 2: return {s, 1.0f, t};
+        case 3: return {s, -1.0f, -t};
+        case 4: return {s, -t, 1.0f};
+        default: return {-s, -t, -1.0f};
+    }
+}
 
+size_t Skybox::memoryFootprint() const {
+    size_t bytes = sizeof(Skybox);
+    for (const auto& face : faces) {
+        bytes += face->memoryFootprint();
+    }
+    return bytes;
+}
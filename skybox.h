@@ -1,17 +1,68 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include "glm/glm.hpp"
 #include "color.h"
+#include "texture.h"
 
+// Sky as a cubemap. The equirectangular image is resampled once into six faces, so
+// a lookup picks the face from the direction's largest component and divides by it
+// instead of calling atan2 and acos.
 class Skybox {
 public:
+    // Faces in the order +X, -X, +Y, -Y, +Z, -Z
+    static const int FACE_COUNT = 6;
+
     Skybox(const std::string& textureFilePath);
-    ~Skybox();
 
-    Color getColor(const glm::vec3& direction) const;
+    // spreadAngle is the ray cone's angular width; wider cones read smaller mip levels
+    Radiance getColor(const glm::vec3& direction, float spreadAngle = 0.0f) const {
+        int face;
+        float u, v;
+        faceCoordinates(direction, face, u, v);
+        float lod = Texture::lodForFootprint(spreadAngle * texelsPerRadian);
+        return bilinear ? faces[face]->sampleBilinear(u, v, lod) : faces[face]->sample(u, v, lod);
+    }
+
+    void setBilinear(bool enabled) { bilinear = enabled; }
+
+    int getFaceSize() const { return faces[0]->getWidth(); }
+    size_t memoryFootprint() const;
+
+    // Face and UV in [0, 1] that `direction` points at; direction need not be normalized
+    static void faceCoordinates(const glm::vec3& direction, int& face, float& u, float& v) {
+        glm::vec3 absDirection = glm::abs(direction);
+        float major, s, t;
+        if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z) {
+            face = direction.x > 0.0f ? 0 : 1;
+            major = absDirection.x;
+            s = direction.x > 0.0f ? -direction.z : direction.z;
+            t = -direction.y;
+        } else if (absDirection.y >= absDirection.z) {
+            face = direction.y > 0.0f ? 2 : 3;
+            major = absDirection.y;
+            s = direction.x;
+            t = direction.y > 0.0f ? direction.z : -direction.z;
+        } else {
+            face = direction.z > 0.0f ? 4 : 5;
+            major = absDirection.z;
+            s = direction.z > 0.0f ? direction.x : -direction.x;
+            t = -direction.y;
+        }
+        float scale = 0.5f / major;
+        u = s * scale + 0.5f;
+        v = t * scale + 0.5f;
+    }
+
+    // Inverse of faceCoordinates() for s, t in [-1, 1]
+    static glm::vec3 faceDirection(int face, float s, float t);
 
 private:
-    SDL_Surface* texture;
     void loadAndConvertTexture(const std::string& textureFilePath);
+
+    std::unique_ptr<Texture> faces[FACE_COUNT];
+    // Texels per radian at a face's center, for mip selection
+    float texelsPerRadian = 0.0f;
+    bool bilinear = false;
 };
@@ -4,6 +4,18 @@ Sphere::Sphere(const glm::vec3& center, float radius, const Material& mat)
         : center(center), radius(radius), Object(mat) {}
 
 Intersect Sphere::rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    return intersect(center, radius, rayOrigin, rayDirection);
+}
+
+Intersect Sphere::intersect(const glm::vec3& center, float radius, const glm::vec3& rayOrigin, const glm::vec3& rayDirection) {
+    float dist;
+    if (!hitDistance(center, radius, rayOrigin, rayDirection, dist)) {
+        return Intersect{false};
+    }
+    return surfaceAt(center, rayOrigin, rayDirection, dist);
+}
+
+bool Sphere::hitDistance(const glm::vec3& center, float radius, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float& dist) {
     glm::vec3 oc = rayOrigin - center;
 
     float a = glm::dot(rayDirection, rayDirection);
@@ -13,16 +25,20 @@ Intersect Sphere::rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayD
     float discriminant = b * b - 4 * a * c;
 
     if (discriminant < 0) {
-        return Intersect{false};
+        return false;
     }
 
-    float dist = (-b - sqrt(discriminant)) / (2.0f * a);
+    dist = (-b - sqrt(discriminant)) / (2.0f * a);
 
-    if (dist < 0) {
-        return Intersect{false};
-    }
+    return dist >= 0;
+}
 
+Intersect Sphere::surfaceAt(const glm::vec3& center, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float dist) {
     glm::vec3 point = rayOrigin + dist * rayDirection;
     glm::vec3 normal = glm::normalize(point - center);
     return Intersect{true, dist, point, normal};
-}
\ No newline at end of file
+}
+
+AABB Sphere::getBounds() const {
+    return AABB{center - glm::vec3(radius), center + glm::vec3(radius)};
+}
@@ -11,6 +11,18 @@ public:
 
     Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const override;
 
+    AABB getBounds() const override;
+
+    // Shared with the flattened Scene
+    static Intersect intersect(const glm::vec3& center, float radius, const glm::vec3& rayOrigin, const glm::vec3& rayDirection);
+
+    // Distance only; surfaceAt() fills in the rest for the hit that ends up closest
+    static bool hitDistance(const glm::vec3& center, float radius, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float& dist);
+    static Intersect surfaceAt(const glm::vec3& center, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float dist);
+
+    const glm::vec3& getCenter() const { return center; }
+    float getRadius() const { return radius; }
+
 private:
     glm::vec3 center;
     float radius;
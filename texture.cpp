@@ -0,0 +1,109 @@
+#include "texture.h"
+#include <stdexcept>
+#include <SDL_image.h>
+
+Texture::Texture(SDL_Surface* surface, TextureWrap wrap) : wrap(wrap) {
+    // Level sizes and offsets first, so texels is allocated once
+    size_t texelCount = 0;
+    int width = surface->w;
+    int height = surface->h;
+    while (true) {
+        Level level{width, height, (width + TILE_SIZE - 1) / TILE_SIZE, texelCount};
+        int tileRows = (height + TILE_SIZE - 1) / TILE_SIZE;
+        texelCount += static_cast<size_t>(level.tilesPerRow) * tileRows * TILE_SIZE * TILE_SIZE;
+        levels.push_back(level);
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    texels.assign(texelCount, 0);
+
+    // RGBA32 is R, G, B, A in memory whatever the byte order
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    if (rgba == nullptr) {
+        throw std::runtime_error("Error converting texture to RGBA: " + std::string(SDL_GetError()));
+    }
+
+    SDL_LockSurface(rgba);
+    for (int y = 0; y < surface->h; y++) {
+        const Uint8* row = static_cast<const Uint8*>(rgba->pixels) + y * rgba->pitch;
+        for (int x = 0; x < surface->w; x++) {
+            const Uint8* p = row + x * 4;
+            texels[texelIndex(levels[0], x, y)] = Uint32(p[0]) | Uint32(p[1]) << 8 | Uint32(p[2]) << 16 | Uint32(p[3]) << 24;
+        }
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+
+    // Each texel averages the 2x2 block above it in linear space; an odd last row or
+    // column is dropped, as in a plain box-filtered mip chain
+    for (size_t i = 1; i < levels.size(); i++) {
+        const Level& source = levels[i - 1];
+        const Level& level = levels[i];
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                int x1 = std::min(2 * x + 1, source.width - 1);
+                int y1 = std::min(2 * y + 1, source.height - 1);
+                Radiance average = (decode(texels[texelIndex(source, 2 * x, 2 * y)]) + decode(texels[texelIndex(source, x1, 2 * y)]) +
+                                    decode(texels[texelIndex(source, 2 * x, y1)]) + decode(texels[texelIndex(source, x1, y1)])) * 0.25f;
+                texels[texelIndex(level, x, y)] = Uint32(linearToSrgb(average.x)) | Uint32(linearToSrgb(average.y)) << 8 |
+                                                  Uint32(linearToSrgb(average.z)) << 16 |
+                                                  Uint32(static_cast<Uint8>(average.w * 255.0f + 0.5f)) << 24;
+            }
+        }
+    }
+}
+
+Radiance Texture::sampleBilinear(float u, float v, float lod) const {
+    const Level& level = levels[levelFor(lod)];
+    float x = u * level.width - 0.5f;
+    float y = v * level.height - 0.5f;
+    int x0 = floorToInt(x);
+    int y0 = floorToInt(y);
+    float fx = x - static_cast<float>(x0);
+    float fy = y - static_cast<float>(y0);
+
+    int left = wrapCoordinate(x0, level.width, false);
+    int right = wrapCoordinate(x0 + 1, level.width, false);
+    int top = wrapCoordinate(y0, level.height, true);
+    int bottom = wrapCoordinate(y0 + 1, level.height, true);
+
+    Radiance topRow = glm::mix(decode(texels[texelIndex(level, left, top)]), decode(texels[texelIndex(level, right, top)]), fx);
+    Radiance bottomRow = glm::mix(decode(texels[texelIndex(level, left, bottom)]), decode(texels[texelIndex(level, right, bottom)]), fx);
+    return glm::mix(topRow, bottomRow, fy);
+}
+
+const Texture* TextureCache::load(const std::string& path, TextureWrap wrap) {
+    auto found = textures.find(path);
+    if (found != textures.end()) {
+        return found->second.get();
+    }
+
+    SDL_Surface* surface = IMG_Load(path.c_str());
+    if (surface == nullptr) {
+        std::cerr << "Unable to load image: " << IMG_GetError() << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<Texture> texture;
+    try {
+        texture = std::make_unique<Texture>(surface, wrap);
+    } catch (const std::runtime_error&) {
+        SDL_FreeSurface(surface);
+        throw;
+    }
+    SDL_FreeSurface(surface);
+
+    const Texture* loaded = texture.get();
+    textures.emplace(path, std::move(texture));
+    return loaded;
+}
+
+size_t TextureCache::memoryFootprint() const {
+    size_t bytes = sizeof(TextureCache);
+    for (const auto& [path, texture] : textures) {
+        bytes += path.capacity() + texture->memoryFootprint();
+    }
+    return bytes;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL.h>
+#include "color.h"
+#include "radiance.h"
+
+enum class TextureWrap {
+    Repeat,
+    Clamp,
+    // Repeats along u and clamps along v, for equirectangular images whose top and
+    // bottom rows are the poles
+    RepeatU
+};
+
+// Image decoded once into RGBA8 sRGB texels, with a mip chain down to 1x1 built by
+// 2x2 box filtering in linear space. Samples are returned as linear Radiance. Each
+// level stores its texels in 4x4 tiles of 64 bytes, one cache line, so neighbouring
+// texels along either axis usually share a line. Level sizes are padded up to whole
+// tiles; padding texels are never read.
+class Texture {
+public:
+    static const int TILE_SHIFT = 2;
+    static const int TILE_SIZE = 1 << TILE_SHIFT;
+
+    // Converts from any SDL pixel format; the surface is not kept
+    Texture(SDL_Surface* surface, TextureWrap wrap = TextureWrap::Repeat);
+
+    int getWidth() const { return levels[0].width; }
+    int getHeight() const { return levels[0].height; }
+    int levelCount() const { return static_cast<int>(levels.size()); }
+    size_t memoryFootprint() const { return sizeof(Texture) + levels.capacity() * sizeof(Level) + texels.capacity() * sizeof(Uint32); }
+
+    // Stored sRGB value
+    Color texel(int level, int x, int y) const { return unpack(texels[texelIndex(levels[level], x, y)]); }
+
+    // Level of detail for a footprint `texels` wide in level 0 texels: 0 at one texel
+    // or less, one more per doubling
+    static float lodForFootprint(float texels) {
+        return texels > 1.0f ? std::log2(texels) : 0.0f;
+    }
+
+    // Nearest texel of the nearest level; u and v outside [0, 1] wrap or clamp
+    Radiance sample(float u, float v, float lod = 0.0f) const {
+        const Level& level = levels[levelFor(lod)];
+        int x = wrapCoordinate(floorToInt(u * level.width), level.width, false);
+        int y = wrapCoordinate(floorToInt(v * level.height), level.height, true);
+        return decode(texels[texelIndex(level, x, y)]);
+    }
+
+    // Blend of the four texels around (u, v) in the nearest level, treating texel
+    // centers as sample points
+    Radiance sampleBilinear(float u, float v, float lod = 0.0f) const;
+
+private:
+    struct Level {
+        int width;
+        int height;
+        int tilesPerRow;
+        // Index of the level's first texel
+        size_t first;
+    };
+
+    static Color unpack(Uint32 packed) {
+        Color color;
+        color.r = static_cast<Uint8>(packed);
+        color.g = static_cast<Uint8>(packed >> 8);
+        color.b = static_cast<Uint8>(packed >> 16);
+        color.a = static_cast<Uint8>(packed >> 24);
+        return color;
+    }
+
+    // Linear RGB; alpha is stored linearly and goes to w
+    static Radiance decode(Uint32 packed) {
+        return Radiance(srgbToLinear(static_cast<Uint8>(packed)), srgbToLinear(static_cast<Uint8>(packed >> 8)),
+                        srgbToLinear(static_cast<Uint8>(packed >> 16)), static_cast<float>(packed >> 24) / 255.0f);
+    }
+
+    int levelFor(float lod) const {
+        int level = static_cast<int>(lod + 0.5f);
+        return level <= 0 ? 0 : std::min(level, levelCount() - 1);
+    }
+
+    // x and y must be inside the level
+    static size_t texelIndex(const Level& level, int x, int y) {
+        size_t tile = static_cast<size_t>(y >> TILE_SHIFT) * level.tilesPerRow + (x >> TILE_SHIFT);
+        return level.first + (tile << (2 * TILE_SHIFT)) + ((y & (TILE_SIZE - 1)) << TILE_SHIFT) + (x & (TILE_SIZE - 1));
+    }
+
+    // std::floor is a library call without SSE4.1
+    static int floorToInt(float value) {
+        int truncated = static_cast<int>(value);
+        return truncated - (value < static_cast<float>(truncated));
+    }
+
+    // vertical: i is a row, along v
+    int wrapCoordinate(int i, int size, bool vertical) const {
+        // UVs inside [0, 1) skip the division
+        if (static_cast<unsigned int>(i) < static_cast<unsigned int>(size)) {
+            return i;
+        }
+        if (wrap == TextureWrap::Clamp || (vertical && wrap == TextureWrap::RepeatU)) {
+            return i < 0 ? 0 : size - 1;
+        }
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+
+    TextureWrap wrap;
+    std::vector<Level> levels;
+    // Every level, packed as r | g << 8 | b << 16 | a << 24
+    std::vector<Uint32> texels;
+};
+
+// Textures by file path; each image is decoded once, however many materials use it
+class TextureCache {
+public:
+    // nullptr when the image can't be loaded. A path keeps the wrap mode of its first load.
+    const Texture* load(const std::string& path, TextureWrap wrap = TextureWrap::Repeat);
+
+    size_t size() const { return textures.size(); }
+    size_t memoryFootprint() const;
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<Texture>> textures;
+};
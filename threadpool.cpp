@@ -0,0 +1,106 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued++;
+        pending++;
+    }
+
+    // Round-robin placement; stealing evens out whatever imbalance is left
+    unsigned int index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::idle() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return pending == 0;
+}
+
+bool ThreadPool::popTask(unsigned int index, std::function<void()>& task) {
+    {
+        TaskQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        TaskQueue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    std::function<void()> task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            taskAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+
+        if (!popTask(index, task)) {
+            // Counted but not pushed yet, or another worker got there first
+            std::this_thread::yield();
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued--;
+        }
+
+        task();
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--pending == 0) {
+            allDone.notify_all();
+        }
+    }
+}
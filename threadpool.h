@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: each worker owns a task deque, pops from its back
+// and steals from the front of the others when it runs dry.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+    // Non-blocking: true when every submitted task has finished
+    bool idle();
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned int index);
+    bool popTask(unsigned int index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    int queued = 0;
+    int pending = 0;
+    bool stopping = false;
+    std::atomic<unsigned int> nextQueue{0};
+};
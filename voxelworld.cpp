@@ -0,0 +1,341 @@
+#include "voxelworld.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+VoxelWorld::VoxelWorld(const glm::ivec3& origin, const glm::ivec3& size)
+        : origin(origin), size(size), bricksSize((size + glm::ivec3(BRICK_SIZE - 1)) / BRICK_SIZE),
+          bricks(static_cast<size_t>(bricksSize.x) * bricksSize.y * bricksSize.z, UNIFORM | EMPTY) {
+    materials.push_back(Material{Color(0, 0, 0), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, nullptr});
+}
+
+VoxelWorld::VoxelWorld(const std::string& path, size_t residentBudget) : stream(std::make_unique<ChunkStream>(path, residentBudget)) {
+    origin = stream->getOrigin();
+    size = stream->getSize();
+    bricksSize = (size + glm::ivec3(BRICK_SIZE - 1)) / BRICK_SIZE;
+    materials.push_back(Material{Color(0, 0, 0), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, nullptr});
+}
+
+Uint8 VoxelWorld::addMaterial(const Material& material) {
+    if (materials.size() > 255) {
+        throw std::runtime_error("VoxelWorld supports at most 255 materials");
+    }
+    materials.push_back(material);
+    return static_cast<Uint8>(materials.size() - 1);
+}
+
+void VoxelWorld::setBlock(const glm::ivec3& position, Uint8 materialId) {
+    if (stream) {
+        throw std::runtime_error("A streamed VoxelWorld is read-only");
+    }
+    glm::ivec3 local = position - origin;
+    if (local.x < 0 || local.y < 0 || local.z < 0 || local.x >= size.x || local.y >= size.y || local.z >= size.z) {
+        return;
+    }
+    size_t index = brickIndex(local.x, local.y, local.z);
+    Uint32 brick = bricks[index];
+    if (brick & UNIFORM) {
+        if (static_cast<Uint8>(brick) == materialId) {
+            return;
+        }
+        // Expand into a slot filled with the brick's ID
+        Uint32 slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotBricks[slot] = static_cast<Uint32>(index);
+        } else {
+            slot = static_cast<Uint32>(slotBricks.size());
+            slotBricks.push_back(static_cast<Uint32>(index));
+            cells.resize(cells.size() + BRICK_CELLS);
+            edited.push_back(false);
+        }
+        std::fill_n(cells.begin() + static_cast<size_t>(slot) * BRICK_CELLS, BRICK_CELLS, static_cast<Uint8>(brick));
+        bricks[index] = brick = slot;
+    }
+    cells[static_cast<size_t>(brick) * BRICK_CELLS + brickCell(local.x, local.y, local.z)] = materialId;
+
+    if (!edited[brick]) {
+        edited[brick] = true;
+        editedSlots.push_back(brick);
+        if (editedSlots.size() >= COMPACT_INTERVAL) {
+            compact();
+        }
+    }
+}
+
+Uint8 VoxelWorld::getBlock(const glm::ivec3& position) const {
+    glm::ivec3 local = position - origin;
+    if (local.x < 0 || local.y < 0 || local.z < 0 || local.x >= size.x || local.y >= size.y || local.z >= size.z) {
+        return EMPTY;
+    }
+    return cellAt(local.x, local.y, local.z);
+}
+
+void VoxelWorld::compact() {
+    for (Uint32 slot : editedSlots) {
+        edited[slot] = false;
+        auto first = cells.begin() + static_cast<size_t>(slot) * BRICK_CELLS;
+        Uint8 id = *first;
+        if (std::all_of(first, first + BRICK_CELLS, [id](Uint8 cell) { return cell == id; })) {
+            bricks[slotBricks[slot]] = UNIFORM | id;
+            freeSlots.push_back(slot);
+        }
+    }
+    editedSlots.clear();
+}
+
+void VoxelWorld::writeChunks(ChunkWriter& writer) const {
+    const int chunkBricks = ChunkStream::BRICKS_PER_AXIS;
+    std::vector<Uint32> chunkEntries(ChunkStream::BRICKS_PER_CHUNK);
+    std::vector<Uint8> chunkCells;
+    for (int cz = 0; cz < bricksSize.z; cz += chunkBricks) {
+        for (int cy = 0; cy < bricksSize.y; cy += chunkBricks) {
+            for (int cx = 0; cx < bricksSize.x; cx += chunkBricks) {
+                // Dense bricks are renumbered in the order they appear in the chunk
+                chunkCells.clear();
+                size_t chunkBlocks = 0;
+                for (int z = 0; z < chunkBricks; z++) {
+                    for (int y = 0; y < chunkBricks; y++) {
+                        for (int x = 0; x < chunkBricks; x++) {
+                            Uint32& entry = chunkEntries[ChunkStream::brickInChunk(x, y, z)];
+                            glm::ivec3 brickPos(cx + x, cy + y, cz + z);
+                            if (brickPos.x >= bricksSize.x || brickPos.y >= bricksSize.y || brickPos.z >= bricksSize.z) {
+                                entry = UNIFORM | EMPTY;
+                                continue;
+                            }
+                            Uint32 brick = bricks[brickIndex(brickPos.x << BRICK_SHIFT, brickPos.y << BRICK_SHIFT, brickPos.z << BRICK_SHIFT)];
+                            if (brick & UNIFORM) {
+                                entry = brick;
+                                chunkBlocks += static_cast<Uint8>(brick) != EMPTY ? BRICK_CELLS : 0;
+                                continue;
+                            }
+                            entry = static_cast<Uint32>(chunkCells.size() / BRICK_CELLS);
+                            auto first = cells.begin() + static_cast<size_t>(brick) * BRICK_CELLS;
+                            chunkCells.insert(chunkCells.end(), first, first + BRICK_CELLS);
+                            chunkBlocks += BRICK_CELLS - std::count(first, first + BRICK_CELLS, static_cast<Uint8>(EMPTY));
+                        }
+                    }
+                }
+                glm::ivec3 chunkMin = origin + glm::ivec3(cx, cy, cz) * BRICK_SIZE;
+                writer.addChunk(chunkMin, chunkEntries.data(), chunkCells.data(), chunkBlocks);
+            }
+        }
+    }
+}
+
+void VoxelWorld::prefetch(const glm::vec3& eye, const glm::vec3& forward, float halfAngle, float distance) const {
+    if (stream) {
+        stream->prefetch(eye, forward, halfAngle, distance);
+    }
+}
+
+size_t VoxelWorld::blockCount() const {
+    if (stream) {
+        return stream->blockCount();
+    }
+    size_t count = 0;
+    for (Uint32 brick : bricks) {
+        // Cells outside size are empty, so a uniformly solid brick lies inside
+        if (brick & UNIFORM) {
+            count += static_cast<Uint8>(brick) != EMPTY ? BRICK_CELLS : 0;
+        } else {
+            auto first = cells.begin() + static_cast<size_t>(brick) * BRICK_CELLS;
+            count += BRICK_CELLS - std::count(first, first + BRICK_CELLS, static_cast<Uint8>(EMPTY));
+        }
+    }
+    return count;
+}
+
+bool VoxelWorld::march(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist, float& dist, glm::ivec3& hitCell,
+                       int& hitAxis) const {
+    const float infinity = std::numeric_limits<float>::max();
+
+    // Work in grid space, where cell (x, y, z) spans [x, x + 1)
+    glm::vec3 p = rayOrigin - glm::vec3(origin);
+    glm::vec3 extent = glm::vec3(size);
+
+    // Clip the ray against the grid bounds
+    float tEnter = 0.0f;
+    float tExit = maxDist;
+    int entryAxis = -1;
+    for (int axis = 0; axis < 3; axis++) {
+        if (rayDirection[axis] == 0.0f) {
+            if (p[axis] < 0.0f || p[axis] >= extent[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float t0 = (0.0f - p[axis]) / rayDirection[axis];
+        float t1 = (extent[axis] - p[axis]) / rayDirection[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        if (t0 > tEnter) {
+            tEnter = t0;
+            entryAxis = axis;
+        }
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) {
+        return false;
+    }
+
+    glm::vec3 start = p + rayDirection * tEnter;
+    glm::ivec3 cell;
+    glm::ivec3 step;
+    glm::vec3 tDelta;
+    for (int axis = 0; axis < 3; axis++) {
+        cell[axis] = std::clamp(static_cast<int>(std::floor(start[axis])), 0, size[axis] - 1);
+        step[axis] = rayDirection[axis] > 0.0f ? 1 : rayDirection[axis] < 0.0f ? -1 : 0;
+        tDelta[axis] = step[axis] != 0 ? static_cast<float>(step[axis]) / rayDirection[axis] : infinity;
+    }
+
+    // Starting inside the grid means the first cell holds the origin
+    bool skipCell = entryAxis == -1;
+    int axis = entryAxis;
+    float t = tEnter;
+
+    while (true) {
+        const int brickMask = ~(BRICK_SIZE - 1);
+        glm::ivec3 brickMin(cell.x & brickMask, cell.y & brickMask, cell.z & brickMask);
+        const Uint8* brickCells = nullptr;
+        Uint32 brick = brickAt(cell.x, cell.y, cell.z, brickCells);
+
+        if (brick == (UNIFORM | EMPTY)) {
+            // Leave through the nearest brick face and land on the cell beyond it
+            float tBrick = infinity;
+            for (int face = 0; face < 3; face++) {
+                if (step[face] != 0) {
+                    int boundary = brickMin[face] + (step[face] > 0 ? BRICK_SIZE : 0);
+                    float tFace = (boundary - p[face]) / rayDirection[face];
+                    if (tFace < tBrick) {
+                        tBrick = tFace;
+                        axis = face;
+                    }
+                }
+            }
+            t = tBrick;
+            if (t > tExit) {
+                return false;
+            }
+            glm::vec3 exit = p + rayDirection * t;
+            for (int face = 0; face < 3; face++) {
+                cell[face] = face == axis ? brickMin[face] + (step[face] > 0 ? BRICK_SIZE : -1)
+                                          : std::clamp(static_cast<int>(std::floor(exit[face])), brickMin[face], brickMin[face] + BRICK_SIZE - 1);
+            }
+            if (cell[axis] < 0 || cell[axis] >= size[axis]) {
+                return false;
+            }
+            skipCell = false;
+            continue;
+        }
+
+        // Cell by cell until the walk leaves the brick
+        glm::vec3 tMax;
+        for (int face = 0; face < 3; face++) {
+            tMax[face] = step[face] != 0 ? (cell[face] + (step[face] > 0 ? 1 : 0) - p[face]) / rayDirection[face] : infinity;
+        }
+        while (true) {
+            Uint8 block = brick & UNIFORM ? static_cast<Uint8>(brick) : brickCells[brickCell(cell.x, cell.y, cell.z)];
+            if (block != EMPTY && !skipCell) {
+                dist = t;
+                hitCell = cell;
+                hitAxis = axis;
+                return true;
+            }
+            skipCell = false;
+
+            // Step into the neighbour across the nearest cell boundary
+            if (tMax.x < tMax.y) {
+                axis = tMax.x < tMax.z ? 0 : 2;
+            } else {
+                axis = tMax.y < tMax.z ? 1 : 2;
+            }
+
+            t = tMax[axis];
+            if (t > tExit) {
+                return false;
+            }
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= size[axis]) {
+                return false;
+            }
+            tMax[axis] += tDelta[axis];
+            if ((cell[axis] & brickMask) != brickMin[axis]) {
+                break;
+            }
+        }
+    }
+}
+
+bool VoxelWorld::rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, Intersect& intersect, Uint8& materialId,
+                              float maxDist) const {
+    float t;
+    glm::ivec3 cell;
+    int axis;
+    if (!march(rayOrigin, rayDirection, maxDist, t, cell, axis)) {
+        return false;
+    }
+
+    glm::vec3 hitPoint = rayOrigin + rayDirection * t;
+    glm::vec3 local = hitPoint - glm::vec3(origin + cell);
+    glm::vec3 hitNormal(0.0f);
+    hitNormal[axis] = rayDirection[axis] > 0.0f ? -1.0f : 1.0f;
+
+    // Same face parameterisation as Cube::rayIntersect
+    float tx, ty;
+    if (axis == 0) {
+        tx = local.y;
+        ty = local.z;
+    } else if (axis == 1) {
+        tx = local.x;
+        ty = local.z;
+    } else {
+        tx = local.x;
+        ty = local.y;
+    }
+
+    materialId = cellAt(cell.x, cell.y, cell.z);
+    intersect = Intersect{true, t, hitPoint, hitNormal, glm::clamp(tx, 0.0f, 1.0f), glm::clamp(ty, 0.0f, 1.0f), 1.0f};
+    return true;
+}
+
+bool VoxelWorld::anyHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist, float& occluderDist,
+                        glm::ivec3& lastOccluder) const {
+    if (blocksRay(lastOccluder, rayOrigin, rayDirection, maxDist, occluderDist)) {
+        return true;
+    }
+    int axis;
+    return march(rayOrigin, rayDirection, maxDist, occluderDist, lastOccluder, axis);
+}
+
+bool VoxelWorld::blocksRay(const glm::ivec3& cell, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist,
+                           float& dist) const {
+    if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= size.x || cell.y >= size.y || cell.z >= size.z ||
+        cellAt(cell.x, cell.y, cell.z) == EMPTY) {
+        return false;
+    }
+    glm::vec3 near = glm::vec3(origin + cell) - rayOrigin;
+    glm::vec3 far = near + 1.0f;
+    float tNear = 0.0f;
+    float tFar = maxDist;
+    for (int axis = 0; axis < 3; axis++) {
+        if (rayDirection[axis] == 0.0f) {
+            if (near[axis] > 0.0f || far[axis] <= 0.0f) {
+                return false;
+            }
+            continue;
+        }
+        float t0 = near[axis] / rayDirection[axis];
+        float t1 = far[axis] / rayDirection[axis];
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+    }
+    // A cell the ray starts in is skipped, as march() does
+    if (tNear <= 0.0f || tNear > tFar) {
+        return false;
+    }
+    dist = tNear;
+    return true;
+}
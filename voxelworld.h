@@ -0,0 +1,146 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "glm/glm.hpp"
+#include "chunkstream.h"
+#include "intersect.h"
+#include "material.h"
+
+// Block scene stored as one material ID (an index into a palette of at most 255
+// materials) per unit cell. Cell (x, y, z) covers [origin + (x, y, z), origin + (x, y, z) + 1).
+//
+// Cells are grouped into bricks of BRICK_SIZE^3. A brick whose cells all hold the same
+// ID, empty air or solid rock, is stored as that ID alone; the others keep one byte
+// per cell in a shared pool. Rays walk the bricks and cross uniformly empty ones in one
+// step, and walk the cells of the others (Amanatides-Woo 3D-DDA); the normal and UV
+// come from the face they cross.
+//
+// A world can also be streamed from a chunk file written by writeChunks(): its bricks
+// then stay in the file and are paged in as rays reach them, see ChunkStream. Such a
+// world is read-only.
+class VoxelWorld {
+public:
+    static const Uint8 EMPTY = 0;
+    static const int BRICK_SHIFT = 3;
+    static const int BRICK_SIZE = 1 << BRICK_SHIFT;
+
+    VoxelWorld(const glm::ivec3& origin, const glm::ivec3& size);
+    // Streams the chunk file at path, keeping about residentBudget bytes of it in memory.
+    // Throws std::runtime_error when the file can't be opened. Materials aren't part of
+    // the file and are added as for any other world, at least getStream()->materialCount()
+    // of them before the first ray.
+    VoxelWorld(const std::string& path, size_t residentBudget);
+
+    // Returns the ID to pass to setBlock(); ID 0 is reserved for empty cells
+    Uint8 addMaterial(const Material& material);
+    const Material& getMaterial(Uint8 materialId) const { return materials[materialId]; }
+    void setMaterial(Uint8 materialId, const Material& material) { materials[materialId] = material; }
+    // Including the empty material
+    size_t materialCount() const { return materials.size(); }
+
+    // Throws std::runtime_error on a streamed world
+    void setBlock(const glm::ivec3& position, Uint8 materialId);
+    Uint8 getBlock(const glm::ivec3& position) const;
+
+    // Stores the bricks edited since the last call whose cells all hold the same ID as
+    // that ID alone and reuses their pool slots. setBlock() calls it every
+    // COMPACT_INTERVAL edited bricks, so building a world never holds many more
+    // bricks than it ends with; call it once more after the last setBlock().
+    void compact();
+
+    // Adds the world's chunks to writer, whose origin and chunk grid the world's origin
+    // and size must line up with; call compact() first. A world larger than memory can be
+    // written as slabs of CHUNK_SIZE cells, each its own VoxelWorld.
+    void writeChunks(ChunkWriter& writer) const;
+
+    // For a streamed world, loads the chunks around the camera in the background, see
+    // ChunkStream::prefetch(); does nothing otherwise
+    void prefetch(const glm::vec3& eye, const glm::vec3& forward, float halfAngle, float distance) const;
+    // nullptr unless the world is streamed
+    const ChunkStream* getStream() const { return stream.get(); }
+
+    // First solid cell along the ray within maxDist. The cell containing the
+    // ray origin is skipped, so rays leaving a block face don't hit that block.
+    bool rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, Intersect& intersect, Uint8& materialId,
+                      float maxDist = std::numeric_limits<float>::max()) const;
+
+    // Occlusion query: distance to a solid cell within maxDist, not necessarily the
+    // first, without the normal and UV. lastOccluder is tried before walking the grid
+    // and is set to the occluding cell, so a caller can keep it for the next ray.
+    bool anyHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist, float& occluderDist,
+                glm::ivec3& lastOccluder) const;
+
+    const glm::ivec3& getOrigin() const { return origin; }
+    const glm::ivec3& getSize() const { return size; }
+    size_t blockCount() const;
+    // Bricks holding a byte per cell
+    size_t denseBrickCount() const { return slotBricks.size() - freeSlots.size(); }
+    size_t memoryFootprint() const {
+        return sizeof(VoxelWorld) + (stream ? stream->memoryFootprint() : 0) + bricks.capacity() * sizeof(Uint32) + cells.capacity() +
+               slotBricks.capacity() * sizeof(Uint32) + freeSlots.capacity() * sizeof(Uint32) + editedSlots.capacity() * sizeof(Uint32) + edited.capacity() / 8 +
+               materials.capacity() * sizeof(Material);
+    }
+
+private:
+    // The DDA walk: distance, cell and crossed axis of the first solid cell within maxDist
+    bool march(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist, float& dist, glm::ivec3& hitCell, int& hitAxis) const;
+    // Whether the ray enters solid cell `cell` (grid coordinates) within maxDist
+    bool blocksRay(const glm::ivec3& cell, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float maxDist, float& dist) const;
+
+    // A brick entry is UNIFORM | ID, or the pool slot of its cells
+    static const Uint32 UNIFORM = ChunkStream::UNIFORM_BRICK;
+    static_assert(BRICK_SHIFT == ChunkStream::BRICK_SHIFT, "chunk files hold VoxelWorld bricks");
+    static const int BRICK_CELLS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static const size_t COMPACT_INTERVAL = 4096;
+
+    size_t brickIndex(int x, int y, int z) const {
+        return static_cast<size_t>(x >> BRICK_SHIFT) +
+               static_cast<size_t>(bricksSize.x) * (static_cast<size_t>(y >> BRICK_SHIFT) + static_cast<size_t>(bricksSize.y) * (z >> BRICK_SHIFT));
+    }
+
+    // Offset of a cell within its brick's slot
+    static size_t brickCell(int x, int y, int z) {
+        const int mask = BRICK_SIZE - 1;
+        return static_cast<size_t>((x & mask) | (y & mask) << BRICK_SHIFT | (z & mask) << (2 * BRICK_SHIFT));
+    }
+
+    // Entry of the brick holding grid cell (x, y, z), which must lie inside size; for
+    // a dense brick, brickCells is set to its IDs
+    Uint32 brickAt(int x, int y, int z, const Uint8*& brickCells) const {
+        if (stream) {
+            return stream->brick(x, y, z, brickCells);
+        }
+        Uint32 brick = bricks[brickIndex(x, y, z)];
+        if (!(brick & UNIFORM)) {
+            brickCells = cells.data() + static_cast<size_t>(brick) * BRICK_CELLS;
+        }
+        return brick;
+    }
+
+    // Grid coordinates inside size
+    Uint8 cellAt(int x, int y, int z) const {
+        const Uint8* brickCells = nullptr;
+        Uint32 brick = brickAt(x, y, z, brickCells);
+        return brick & UNIFORM ? static_cast<Uint8>(brick) : brickCells[brickCell(x, y, z)];
+    }
+
+    glm::ivec3 origin;
+    glm::ivec3 size;
+    // Bricks per axis, rounded up
+    glm::ivec3 bricksSize;
+    std::vector<Uint32> bricks;
+    // BRICK_CELLS IDs per slot
+    std::vector<Uint8> cells;
+    // Brick index of each slot, and the slots no brick uses
+    std::vector<Uint32> slotBricks;
+    std::vector<Uint32> freeSlots;
+    // Slots changed since the last compact()
+    std::vector<Uint32> editedSlots;
+    std::vector<bool> edited;
+    std::vector<Material> materials;
+    std::unique_ptr<ChunkStream> stream;
+};